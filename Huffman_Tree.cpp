@@ -11,6 +11,8 @@
 #include <unordered_map>
 #include <queue>
 #include <stack>
+#include <string>
+#include "parallel.h"
 
 using namespace std;
 
@@ -47,6 +49,25 @@ HTNode* buildHT(unordered_map<char,double> weights) {
     return pq.top();
 }
 
+// Frees a tree returned by buildHT or buildDecoder
+void freeHT(HTNode* root) {
+    stack<HTNode*> s;
+    if (root) {
+        s.push(root);
+    }
+    while (!s.empty()) {
+        HTNode* cur = s.top();
+        s.pop();
+        if (cur->left) {
+            s.push(cur->left);
+        }
+        if (cur->right) {
+            s.push(cur->right);
+        }
+        delete cur;
+    }
+}
+
 // Builds a Huffman tree and returns therefrom a map of prefix codes given a map of character weights
 unordered_map<char,string> getHuffmanCode(unordered_map<char,double> weights) {
     unordered_map<char,string> encoding;
@@ -56,6 +77,7 @@ unordered_map<char,string> getHuffmanCode(unordered_map<char,double> weights) {
     // If there is only one character, encode it with "0"
     if (!root->left) {
         encoding[root->name] = "0";
+        freeHT(root);
         return encoding;
     }
     
@@ -68,8 +90,8 @@ unordered_map<char,string> getHuffmanCode(unordered_map<char,double> weights) {
         if (cur) {
             if (s.empty() || cur != s.top().first) {
                 s.push(make_pair(cur, false));
-                if (cur->name != 0) {
-                    encoding[cur->name] = code; // Only nodes that represent characters are encoded
+                if (!cur->left && !cur->right) {
+                    encoding[cur->name] = code; // Only leaves represent characters, so '\0' is a valid name
                 }
                 if (cur = cur->left) {
                     code.push_back('0');
@@ -95,7 +117,266 @@ unordered_map<char,string> getHuffmanCode(unordered_map<char,double> weights) {
         }
     }
     
+    freeHT(root);
     return encoding;
 }
 
 // ----------------------------------------------------------------------------------------------------------
+
+
+// PARALLEL BLOCK-BASED HUFFMAN COMPRESSION -----------------------------------------------------------------
+
+// The input is cut into independent blocks of blockSize characters. Each block gets its own histogram and code,
+//  so blocks can be compressed and decompressed concurrently, and any block can be decoded without the others.
+// Runs in O(N + B*s*logs) work for N characters, B blocks and an alphabet of size s
+
+// A self-contained compressed block. The code table is stored with the bits so the block decodes on its own.
+struct HuffmanBlock {
+    unordered_map<char,string> code;
+    vector<unsigned char> bits; // Packed most significant bit first
+    long long numChars;
+};
+
+// Block i covers characters [i*blockSize, min((i+1)*blockSize, length)), so blocks doubles as the block index
+struct HuffmanStream {
+    long long blockSize;
+    long long length;
+    vector<HuffmanBlock> blocks;
+};
+
+// Rebuilds a decoding tree from a map of prefix codes: '0' goes left and '1' goes right
+HTNode* buildDecoder(const unordered_map<char,string> &code) {
+    HTNode* root = new HTNode{0, 0, nullptr, nullptr};
+    for (auto &i : code) {
+        HTNode* cur = root;
+        for (char bit : i.second) {
+            HTNode* &next = bit == '0' ? cur->left : cur->right;
+            if (!next) {
+                next = new HTNode{0, 0, nullptr, nullptr};
+            }
+            cur = next;
+        }
+        cur->name = i.first;
+    }
+    return root;
+}
+
+// Compresses data[begin, end) with a code built from the histogram of that range only
+HuffmanBlock compressBlock(const string &data, long long begin, long long end) {
+    HuffmanBlock block;
+    block.numChars = end - begin;
+    long long freq[256] = {};
+    for (long long i=begin; i<end; i++) {
+        freq[(unsigned char)data[i]]++;
+    }
+    unordered_map<char,double> weights;
+    for (int c=0; c<256; c++) {
+        if (freq[c]) {
+            weights[(char)c] = freq[c];
+        }
+    }
+    block.code = getHuffmanCode(weights);
+    
+    // Flat lookup table so the hot loop avoids hashing
+    string table[256];
+    for (auto &i : block.code) {
+        table[(unsigned char)i.first] = i.second;
+    }
+    unsigned char acc = 0;
+    int used = 0; // Bits already placed in acc
+    for (long long i=begin; i<end; i++) {
+        for (char bit : table[(unsigned char)data[i]]) {
+            acc = (unsigned char)((acc << 1) | (bit == '1'));
+            if (++used == 8) {
+                block.bits.push_back(acc);
+                acc = 0;
+                used = 0;
+            }
+        }
+    }
+    if (used) {
+        block.bits.push_back((unsigned char)(acc << (8 - used)));
+    }
+    return block;
+}
+
+// Splits data into blocks and compresses them on numThreads threads
+// The workers are started once per call and claim blocks from a shared counter until none are left, so a call
+//  pays for thread creation once rather than per block. Block sizes below 1 are treated as 1.
+HuffmanStream compressBlocks(const string &data, long long blockSize = 1 << 20, int numThreads = defaultThreads()) {
+    blockSize = max(1LL, blockSize);
+    HuffmanStream stream;
+    stream.blockSize = blockSize;
+    stream.length = (long long)data.size();
+    stream.blocks.resize((stream.length + blockSize - 1) / blockSize);
+    parallelFor(0, (long long)stream.blocks.size(), [&](long long i) {
+        stream.blocks[i] = compressBlock(data, i * blockSize, min(stream.length, (i+1) * blockSize));
+    }, numThreads);
+    return stream;
+}
+
+// Decodes block i into out, which must have room for its numChars characters
+void decompressBlockInto(const HuffmanBlock &block, char* out) {
+    HTNode* root = buildDecoder(block.code);
+    HTNode* cur = root;
+    long long written = 0;
+    for (long long i=0; written < block.numChars; i++) {
+        cur = (block.bits[i >> 3] >> (7 - (i & 7))) & 1 ? cur->right : cur->left;
+        if (!cur->left && !cur->right) {
+            out[written++] = cur->name;
+            cur = root;
+        }
+    }
+    freeHT(root);
+}
+
+// Random access: decodes only block i of the stream
+string decompressBlock(const HuffmanStream &stream, int i) {
+    string out(stream.blocks[i].numChars, 0);
+    decompressBlockInto(stream.blocks[i], &out[0]);
+    return out;
+}
+
+// Decodes the whole stream, with each thread writing its blocks straight into their slice of the output
+string decompress(const HuffmanStream &stream, int numThreads = defaultThreads()) {
+    string out(stream.length, 0);
+    parallelFor(0, (long long)stream.blocks.size(), [&](long long i) {
+        decompressBlockInto(stream.blocks[i], &out[i * stream.blockSize]);
+    }, numThreads);
+    return out;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+
+// ADAPTIVE (ONE-PASS) HUFFMAN CODING -----------------------------------------------------------------------
+
+// Codes a message in a single pass without sending a code table. Encoder and decoder both start from a flat
+//  histogram (every byte counted once), code each character with the current code and then count it.
+// The code is rebuilt from the running histogram after 1, 2, 4, ... characters and then every interval
+//  characters, so the decoder rebuilds exactly the same code at exactly the same position.
+// Runs in O(N + (N/interval + logN) * s*logs) time for N characters and an alphabet of size s = 256
+
+struct AdaptiveHuffman {
+    long long counts[256];
+    string code[256];
+    HTNode* root; // Decoding tree matching code
+    long long seen;
+    long long nextRebuild;
+    long long interval;
+};
+
+// Rebuilds the code from the running histogram
+// Ties are broken by node creation order rather than by buildHT's heap order, so the result depends on the
+//  counts alone and both ends agree regardless of the standard library they are built with
+void rebuildAdaptive(AdaptiveHuffman &ah) {
+    freeHT(ah.root);
+    vector<HTNode*> nodes;
+    // (weight, id) pairs. Leaves take ids 0-255, internal nodes are numbered in creation order.
+    priority_queue<pair<long long,int>, vector<pair<long long,int>>, greater<pair<long long,int>>> pq;
+    for (int c=0; c<256; c++) {
+        nodes.push_back(new HTNode{(char)c, (double)ah.counts[c], nullptr, nullptr});
+        pq.push(make_pair(ah.counts[c], c));
+    }
+    pair<long long,int> first, second;
+    while (pq.size() > 1) {
+        first = pq.top();
+        pq.pop();
+        second = pq.top();
+        pq.pop();
+        nodes.push_back(new HTNode{0, (double)(first.first+second.first), nodes[first.second], nodes[second.second]});
+        pq.push(make_pair(first.first+second.first, (int)nodes.size()-1));
+    }
+    ah.root = nodes.back();
+    
+    // Every byte has a leaf, so the root always has two children and no code is empty
+    stack<pair<HTNode*,string>> s;
+    s.push(make_pair(ah.root, string()));
+    while (!s.empty()) {
+        pair<HTNode*,string> cur = s.top();
+        s.pop();
+        if (!cur.first->left) {
+            ah.code[(unsigned char)cur.first->name] = cur.second;
+        } else {
+            s.push(make_pair(cur.first->left, cur.second + '0'));
+            s.push(make_pair(cur.first->right, cur.second + '1'));
+        }
+    }
+}
+
+AdaptiveHuffman* makeAdaptiveHuffman(long long interval = 4096) {
+    AdaptiveHuffman* ah = new AdaptiveHuffman();
+    fill(ah->counts, ah->counts + 256, 1);
+    ah->root = nullptr;
+    ah->seen = 0;
+    ah->nextRebuild = 1;
+    ah->interval = interval;
+    rebuildAdaptive(*ah);
+    return ah;
+}
+
+void freeAdaptiveHuffman(AdaptiveHuffman* ah) {
+    freeHT(ah->root);
+    delete ah;
+}
+
+// Counts a character that has just been coded and rebuilds the code if a rebuild point is reached
+void adaptiveUpdate(AdaptiveHuffman &ah, char c) {
+    ah.counts[(unsigned char)c]++;
+    if (++ah.seen == ah.nextRebuild) {
+        ah.nextRebuild = min(2 * ah.seen, ah.seen + ah.interval);
+        rebuildAdaptive(ah);
+    }
+}
+
+// Appends the code of c to bits (packed most significant bit first), numBits being the bits used so far
+void adaptiveEncodeChar(AdaptiveHuffman &ah, char c, vector<unsigned char> &bits, long long &numBits) {
+    for (char bit : ah.code[(unsigned char)c]) {
+        if ((numBits & 7) == 0) {
+            bits.push_back(0);
+        }
+        if (bit == '1') {
+            bits.back() |= (unsigned char)(0x80 >> (numBits & 7));
+        }
+        numBits++;
+    }
+    adaptiveUpdate(ah, c);
+}
+
+// Decodes one character starting at bit pos and advances pos past it
+char adaptiveDecodeChar(AdaptiveHuffman &ah, const vector<unsigned char> &bits, long long &pos) {
+    HTNode* cur = ah.root;
+    while (cur->left) {
+        cur = (bits[pos >> 3] >> (7 - (pos & 7))) & 1 ? cur->right : cur->left;
+        pos++;
+    }
+    char c = cur->name;
+    adaptiveUpdate(ah, c);
+    return c;
+}
+
+// Codes a whole message in one pass
+vector<unsigned char> adaptiveEncode(const string &msg, long long interval = 4096) {
+    vector<unsigned char> bits;
+    long long numBits = 0;
+    AdaptiveHuffman* ah = makeAdaptiveHuffman(interval);
+    for (char c : msg) {
+        adaptiveEncodeChar(*ah, c, bits, numBits);
+    }
+    freeAdaptiveHuffman(ah);
+    return bits;
+}
+
+// Decodes numChars characters. interval must match the one used for encoding.
+string adaptiveDecode(const vector<unsigned char> &bits, long long numChars, long long interval = 4096) {
+    string msg;
+    long long pos = 0;
+    AdaptiveHuffman* ah = makeAdaptiveHuffman(interval);
+    for (long long i=0; i<numChars; i++) {
+        msg.push_back(adaptiveDecodeChar(*ah, bits, pos));
+    }
+    freeAdaptiveHuffman(ah);
+    return msg;
+}
+
+// ----------------------------------------------------------------------------------------------------------
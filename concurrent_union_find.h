@@ -0,0 +1,93 @@
+// Lock-free concurrent union-find, shared by union_find.cpp and the parallel graph algorithms of
+//  undirected_graph.cpp
+
+#ifndef CONCURRENT_UNION_FIND_H
+#define CONCURRENT_UNION_FIND_H
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+#include "parallel.h"
+
+using namespace std;
+
+// A lock-free union-find that any number of threads may call Find, Union and SameSet on at the same time
+// Roots are linked by index, the larger root under the smaller one, with a single compare-and-swap that fails
+//  if the larger root has meanwhile been linked elsewhere, in which case the union retries from the new roots.
+//  Since every link points to a smaller index, the parent pointers can never form a cycle.
+// Find uses path splitting: each node on the path is pointed at its grandparent with a compare-and-swap. A
+//  failed or outdated split only skips a shortcut, and any value a node can hold is still one of its
+//  ancestors, so races never break the structure.
+// When node ids bear no relation to the order of unions, linking by index acts as Jayanti and Tarjan's randomized
+//  linking, and operations take O(logn) expected time
+
+struct ConcurrentUnionFind {
+    vector<atomic<uint32_t>> parent; // parent[i] == i iff i is a root
+};
+
+inline ConcurrentUnionFind makeConcurrentUF(int n) {
+    ConcurrentUnionFind uf {vector<atomic<uint32_t>>(n)};
+    for (int i=0; i<n; i++) {
+        uf.parent[i].store(i, memory_order_relaxed);
+    }
+    return uf;
+}
+
+// Returns the current root of a's group. Under concurrent unions the root may be linked elsewhere right after.
+inline int Find(ConcurrentUnionFind &uf, int a) {
+    uint32_t cur = a;
+    while (true) {
+        uint32_t p = uf.parent[cur].load(memory_order_acquire);
+        uint32_t gp = uf.parent[p].load(memory_order_acquire);
+        if (p == gp) {
+            return (int)p;
+        }
+        uf.parent[cur].compare_exchange_weak(p, gp, memory_order_release, memory_order_relaxed);
+        cur = p;
+    }
+}
+
+// Merges the groups of a and b. Returns true if this call merged them, false if they were already together.
+inline bool Union(ConcurrentUnionFind &uf, int a, int b) {
+    while (true) {
+        uint32_t first = Find(uf, a);
+        uint32_t second = Find(uf, b);
+        if (first == second) {
+            return false;
+        }
+        if (first < second) {
+            swap(first, second);
+        }
+        // first is the larger root. Link it under second unless it stopped being a root.
+        uint32_t expected = first;
+        if (uf.parent[first].compare_exchange_strong(expected, second, memory_order_acq_rel)) {
+            return true;
+        }
+    }
+}
+
+// Returns whether a and b are in the same group at some moment during the call
+inline bool SameSet(ConcurrentUnionFind &uf, int a, int b) {
+    while (true) {
+        a = Find(uf, a);
+        b = Find(uf, b);
+        if (a == b) {
+            return true;
+        }
+        // If a is still a root, a and b were in different groups when b's root was found
+        if (uf.parent[a].load(memory_order_acquire) == (uint32_t)a) {
+            return false;
+        }
+    }
+}
+
+// Points every node directly at its root on numThreads threads, so that parent[i] is the root of i until the
+//  next union. Must not run concurrently with unions.
+inline void flattenUF(ConcurrentUnionFind &uf, int numThreads = defaultThreads()) {
+    parallelFor(0, (long long)uf.parent.size(), [&](long long v) {
+        uf.parent[v].store(Find(uf, (int)v), memory_order_relaxed);
+    }, numThreads, 4096);
+}
+
+#endif
@@ -0,0 +1,350 @@
+// Contraction hierarchies for repeated shortest-distance queries on a static directed graph
+// Graphs are represented with adjacency lists of (node, distance) pairs, with n nodes as distinct ints from 0 to
+//  n-1, and edge lengths must be non-negative
+
+// Preprocessing ranks the nodes by importance and contracts them from least to most important. Contracting v
+//  removes it and adds a shortcut u->w of length len(u,v)+len(v,w) wherever that path is the only shortest one
+//  among the remaining nodes. Every shortest path then has an equally short counterpart that first climbs to
+//  higher ranks and then descends, so a query only searches upward from both ends and settles a few hundred
+//  nodes on road-like graphs, however large they are.
+// Shortcut lengths are ints like every other length, so buildCH fails and returns false when a shortcut would be
+//  longer than INT_MAX, which takes two nodes more than INT_MAX apart. Query distances are 64-bit.
+
+#include <iostream>
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <climits>
+#include "csr_graph.h"
+#include "graph_snapshot.h"
+
+using namespace std;
+
+typedef pair<int,int> pi;
+typedef vector<vector<pi>> weighted_graph; // (node,distance) pairs
+typedef pair<long long,int> pli;
+
+// The searchable form of a hierarchy. Both graphs only hold edges towards higher-ranked nodes.
+struct ContractionHierarchy {
+    vector<int> rank; // Contraction order: rank[v] = i if v was the i-th node contracted
+    CSRGraph up; // Edges u->w of the augmented graph with rank[u] < rank[w]
+    CSRGraph down; // Edges u->w with rank[u] > rank[w], stored reversed as w->u for the backward search
+};
+
+
+// 1. PREPROCESSING -----------------------------------------------------------------------------------------
+
+// Working state of the contraction. A contracted node is removed from its neighbours' lists, so searches only see
+//  the remaining graph, while its own lists keep exactly its edges to higher-ranked nodes.
+struct CHBuilder {
+    vector<vector<pi>> out, in;
+    vector<char> contracted;
+    vector<int> contractedNeighbours; // Raises the priority of nodes around contracted areas, spreading the order
+    bool tooLong; // Set once a shortcut longer than INT_MAX is needed
+    // Witness search buffers, reset through the touched list
+    vector<long long> dist;
+    vector<int> touched;
+    vector<char> isTarget; // Out-neighbours of the node being contracted
+};
+
+// Adds u->w or shortens an existing u->w edge. Returns false if an edge at least as short already exists.
+bool addOrShorten(vector<pi> &adj, int to, int len) {
+    for (pi &p : adj) {
+        if (p.first == to) {
+            if (p.second <= len) {
+                return false;
+            }
+            p.second = len;
+            return true;
+        }
+    }
+    adj.push_back(make_pair(to, len));
+    return true;
+}
+
+// Removes the edge to node from adj, which holds at most one
+void removeEdge(vector<pi> &adj, int node) {
+    for (size_t i=0; i<adj.size(); i++) {
+        if (adj[i].first == node) {
+            adj[i] = adj.back();
+            adj.pop_back();
+            return;
+        }
+    }
+}
+
+// Limited Dijkstra from source among uncontracted nodes other than skip, stopping once all target nodes are
+//  settled, distances exceed limit, or settleLimit nodes are settled. Giving up early only costs an unnecessary
+//  shortcut, never a wrong answer.
+void witnessSearch(CHBuilder &b, int source, int skip, int targets, long long limit, int settleLimit) {
+    for (int v : b.touched) {
+        b.dist[v] = LLONG_MAX;
+    }
+    b.touched.clear();
+    priority_queue<pli, vector<pli>, greater<pli>> pq;
+    b.dist[source] = 0;
+    b.touched.push_back(source);
+    pq.push(make_pair(0, source));
+    int settled = 0;
+    while (!pq.empty() && settled < settleLimit && targets > 0) {
+        pli cur = pq.top();
+        pq.pop();
+        if (cur.first > b.dist[cur.second]) {
+            continue;
+        }
+        if (cur.first > limit) {
+            break;
+        }
+        settled++;
+        targets -= b.isTarget[cur.second];
+        for (pi p : b.out[cur.second]) {
+            if (p.first == skip) {
+                continue;
+            }
+            long long nd = cur.first + p.second;
+            if (nd < b.dist[p.first]) {
+                if (b.dist[p.first] == LLONG_MAX) {
+                    b.touched.push_back(p.first);
+                }
+                b.dist[p.first] = nd;
+                pq.push(make_pair(nd, p.first));
+            }
+        }
+    }
+}
+
+// Contracts v, or only counts the shortcuts that contracting it would add if simulate is set
+// Returns the number of shortcuts
+// A shortcut longer than INT_MAX is only trusted after an unlimited witness search, since it means u and w are
+//  that far apart. Contracting then sets tooLong instead of adding it.
+int contractNode(CHBuilder &b, int v, bool simulate) {
+    const int settleLimit = simulate ? 50 : 500;
+    int shortcuts = 0;
+    long long maxOut = 0;
+    for (pi p : b.out[v]) {
+        maxOut = max(maxOut, (long long)p.second);
+        b.isTarget[p.first] = 1;
+    }
+    int targets = (int)b.out[v].size();
+    for (pi in : b.in[v]) {
+        int u = in.first;
+        witnessSearch(b, u, v, targets, in.second + maxOut, settleLimit);
+        bool exhaustive = false;
+        for (pi outE : b.out[v]) {
+            int w = outE.first;
+            if (w == u) {
+                continue;
+            }
+            long long viaV = (long long)in.second + outE.second;
+            if (viaV > INT_MAX && !exhaustive) {
+                witnessSearch(b, u, v, targets, in.second + maxOut, INT_MAX);
+                exhaustive = true;
+            }
+            if (b.dist[w] <= viaV) {
+                continue; // A witness path avoids v
+            }
+            shortcuts++;
+            if (simulate) {
+                continue;
+            }
+            if (viaV > INT_MAX) {
+                b.tooLong = true;
+            } else if (addOrShorten(b.out[u], w, (int)viaV)) {
+                addOrShorten(b.in[w], u, (int)viaV);
+            }
+        }
+    }
+    for (pi p : b.out[v]) {
+        b.isTarget[p.first] = 0;
+    }
+    return shortcuts;
+}
+
+// Edge difference plus contracted neighbours. Lower priorities are contracted first.
+int nodePriority(CHBuilder &b, int v) {
+    int degree = (int)(b.out[v].size() + b.in[v].size());
+    return contractNode(b, v, true) - degree + b.contractedNeighbours[v];
+}
+
+// Orders and contracts all nodes of g into ch
+// After each contraction only the neighbours of the contracted node have their priorities recomputed
+// Returns false if a shortcut longer than INT_MAX is needed, as it does not fit the int lengths of the up and
+//  down graphs. This only happens when two nodes are more than INT_MAX apart, and queries add up lengths in 64 bits.
+bool buildCH(const weighted_graph &g, ContractionHierarchy &ch) {
+    int n = (int)g.size();
+    CHBuilder b {weighted_graph(n), weighted_graph(n), vector<char>(n), vector<int>(n), false,
+                 vector<long long>(n, LLONG_MAX), {}, vector<char>(n)};
+    for (int u=0; u<n; u++) {
+        for (pi p : g[u]) {
+            if (p.first != u && addOrShorten(b.out[u], p.first, p.second)) {
+                addOrShorten(b.in[p.first], u, p.second);
+            }
+        }
+    }
+
+    vector<int> priority(n); // Current priority of each node. Queue entries that differ from it are stale.
+    priority_queue<pi, vector<pi>, greater<pi>> pq; // (priority, node)
+    for (int v=0; v<n; v++) {
+        priority[v] = nodePriority(b, v);
+        pq.push(make_pair(priority[v], v));
+    }
+    ch.rank.assign(n, -1);
+    vector<int> refreshed(n, -1); // Last contracted node whose contraction refreshed each node's priority
+    int next = 0;
+    while (!pq.empty()) {
+        pi top = pq.top();
+        pq.pop();
+        int v = top.second;
+        if (b.contracted[v] || top.first != priority[v]) {
+            continue;
+        }
+        contractNode(b, v, false);
+        if (b.tooLong) {
+            return false;
+        }
+        b.contracted[v] = 1;
+        ch.rank[v] = next++;
+        for (pi e : b.in[v]) {
+            removeEdge(b.out[e.first], v);
+        }
+        for (pi e : b.out[v]) {
+            removeEdge(b.in[e.first], v);
+        }
+        // Only the neighbours' priorities depend on v's contraction
+        for (const vector<pi> *adj : {&b.out[v], &b.in[v]}) {
+            for (pi e : *adj) {
+                int u = e.first;
+                if (refreshed[u] == v) {
+                    continue;
+                }
+                refreshed[u] = v;
+                b.contractedNeighbours[u]++;
+                priority[u] = nodePriority(b, u);
+                pq.push(make_pair(priority[u], u));
+            }
+        }
+    }
+
+    // The augmented graph (original edges plus shortcuts) is now split by rank: out holds the upward edges and in
+    //  the downward edges reversed
+    vector<pair<int,pi>> upEdges, downEdges;
+    for (int u=0; u<n; u++) {
+        for (pi p : b.out[u]) {
+            upEdges.push_back(make_pair(p.second, make_pair(u, p.first)));
+        }
+        for (pi p : b.in[u]) {
+            downEdges.push_back(make_pair(p.second, make_pair(u, p.first)));
+        }
+    }
+    ch.up = buildCSR(n, upEdges);
+    ch.down = buildCSR(n, downEdges);
+    return true;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+
+// 2. SAVING AND LOADING ------------------------------------------------------------------------------------
+
+// A hierarchy is stored as three files: the rank array and two graph snapshots in the format of
+//  graph_snapshot.h, so loading maps the search graphs without parsing
+// Each function returns false on I/O errors
+
+bool saveCH(const ContractionHierarchy &ch, const string &prefix) {
+    FILE* f = fopen((prefix + ".rank").c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+    bool ok = fwrite(ch.rank.data(), sizeof(int), ch.rank.size(), f) == ch.rank.size();
+    ok = fclose(f) == 0 && ok;
+    return ok && saveSnapshot(ch.up, prefix + ".up") && saveSnapshot(ch.down, prefix + ".down");
+}
+
+bool loadCH(const string &prefix, ContractionHierarchy &ch) {
+    if (!loadSnapshot(prefix + ".up", ch.up) || !loadSnapshot(prefix + ".down", ch.down) ||
+        ch.up.size() != ch.down.size()) {
+        return false;
+    }
+    FILE* f = fopen((prefix + ".rank").c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+    ch.rank.resize(ch.up.size());
+    bool ok = fread(ch.rank.data(), sizeof(int), ch.rank.size(), f) == ch.rank.size();
+    fclose(f);
+    return ok;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+
+// 3. QUERIES -----------------------------------------------------------------------------------------------
+
+// Reusable query state. Distances are reset through the touched lists, so a query costs time proportional to
+//  the nodes it reaches rather than to n.
+struct CHQuery {
+    vector<long long> dist[2]; // 0: forward search on up, 1: backward search on down
+    vector<int> touched[2];
+    priority_queue<pli, vector<pli>, greater<pli>> pq[2];
+};
+
+CHQuery makeCHQuery(const ContractionHierarchy &ch) {
+    CHQuery q;
+    for (int side=0; side<2; side++) {
+        q.dist[side].assign(ch.up.size(), LLONG_MAX);
+    }
+    return q;
+}
+
+// Returns the shortest distance from source to target, or -1 if unreachable
+// Both searches only climb in rank. The answer is the best node settled by both, and each search stops once its
+//  queue minimum reaches the best answer found so far.
+long long queryCH(const ContractionHierarchy &ch, CHQuery &q, int source, int target) {
+    for (int side=0; side<2; side++) {
+        for (int v : q.touched[side]) {
+            q.dist[side][v] = LLONG_MAX;
+        }
+        q.touched[side].clear();
+        q.pq[side] = priority_queue<pli, vector<pli>, greater<pli>>();
+    }
+    q.dist[0][source] = 0;
+    q.dist[1][target] = 0;
+    q.touched[0].push_back(source);
+    q.touched[1].push_back(target);
+    q.pq[0].push(make_pair(0, source));
+    q.pq[1].push(make_pair(0, target));
+    long long best = LLONG_MAX;
+
+    while (!q.pq[0].empty() || !q.pq[1].empty()) {
+        for (int side=0; side<2; side++) {
+            if (q.pq[side].empty()) {
+                continue;
+            }
+            pli cur = q.pq[side].top();
+            q.pq[side].pop();
+            if (cur.first >= best) {
+                q.pq[side] = priority_queue<pli, vector<pli>, greater<pli>>(); // Nothing better on this side
+                continue;
+            }
+            if (cur.first > q.dist[side][cur.second]) {
+                continue;
+            }
+            if (q.dist[1-side][cur.second] != LLONG_MAX) {
+                best = min(best, cur.first + q.dist[1-side][cur.second]);
+            }
+            for (pi p : (side == 0 ? ch.up[cur.second] : ch.down[cur.second])) {
+                long long nd = cur.first + p.second;
+                if (nd < q.dist[side][p.first]) {
+                    if (q.dist[side][p.first] == LLONG_MAX) {
+                        q.touched[side].push_back(p.first);
+                    }
+                    q.dist[side][p.first] = nd;
+                    q.pq[side].push(make_pair(nd, p.first));
+                }
+            }
+        }
+    }
+    return best == LLONG_MAX ? -1 : best;
+}
+
+// ----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,204 @@
+// Compressed sparse row (CSR) graph representation shared by the graph algorithms
+// Nodes are distinct ints from 0 to n-1. The neighbours of node u are targets[offsets[u]] to
+//  targets[offsets[u+1]-1], with the matching edge lengths in weights when the graph is weighted.
+// g[u] behaves like an adjacency list: each edge converts to int (the neighbour) or to pi (neighbour, length),
+//  so the algorithms written against graph and weighted_graph accept a CSRGraph unchanged.
+
+#ifndef CSR_GRAPH_H
+#define CSR_GRAPH_H
+
+#include <vector>
+#include <utility>
+#include <memory>
+
+using namespace std;
+
+typedef pair<int,int> pi;
+
+struct CSREdge {
+    int to;
+    int len; // 1 for unweighted graphs
+    operator int() const { return to; }
+    operator pi() const { return make_pair(to, len); }
+};
+
+struct CSRIterator {
+    const int* t;
+    const int* w; // nullptr for unweighted graphs
+    CSREdge operator*() const { return CSREdge{*t, w ? *w : 1}; }
+    CSRIterator& operator++() {
+        t++;
+        if (w) {
+            w++;
+        }
+        return *this;
+    }
+    bool operator!=(const CSRIterator &other) const { return t != other.t; }
+};
+
+// The neighbours of a single node
+struct CSRRange {
+    const int* t;
+    const int* w;
+    int n;
+    CSRIterator begin() const { return CSRIterator{t, w}; }
+    CSRIterator end() const { return CSRIterator{t + n, w ? w + n : nullptr}; }
+    int size() const { return n; }
+    CSREdge operator[](int i) const { return CSREdge{t[i], w ? w[i] : 1}; }
+};
+
+// Immutable once built. Pass by const reference; copies are cheap and share the same arrays.
+// The arrays are owned by storage, which is either a set of vectors or a memory-mapped snapshot file.
+struct CSRGraph {
+    const long long* offsets = nullptr; // n+1 entries
+    const int* targets = nullptr; // m entries
+    const int* weights = nullptr; // m entries, or nullptr if unweighted
+    int n = 0;
+    long long m = 0;
+    shared_ptr<void> storage;
+
+    int size() const { return n; }
+    long long numEdges() const { return m; }
+    bool hasWeights() const { return weights != nullptr; }
+    int degree(int u) const { return (int)(offsets[u+1] - offsets[u]); }
+    CSRRange operator[](int u) const {
+        return CSRRange{targets + offsets[u], weights ? weights + offsets[u] : nullptr, degree(u)};
+    }
+};
+
+// Backing store for CSR graphs built in memory
+struct CSRArrays {
+    vector<long long> offsets;
+    vector<int> targets;
+    vector<int> weights;
+};
+
+// Wraps arrays into a CSRGraph that takes ownership of them
+inline CSRGraph makeCSR(vector<long long> offsets, vector<int> targets, vector<int> weights = {}) {
+    shared_ptr<CSRArrays> arrays(new CSRArrays {move(offsets), move(targets), move(weights)});
+    CSRGraph g;
+    g.n = (int)arrays->offsets.size() - 1;
+    g.m = arrays->offsets.back();
+    g.offsets = arrays->offsets.data();
+    g.targets = arrays->targets.data();
+    g.weights = arrays->weights.empty() ? nullptr : arrays->weights.data();
+    g.storage = arrays;
+    return g;
+}
+
+// Builds a CSR graph with n nodes from a list of edges given as (start, end) pairs
+// Each edge is stored in both directions if undirected is set
+// Runs in O(n+m) time with a counting sort by start node
+inline CSRGraph buildCSR(int n, const vector<pi> &edges, bool undirected = false) {
+    CSRArrays g;
+    g.offsets.assign(n + 1, 0);
+    for (const pi &e : edges) {
+        g.offsets[e.first + 1]++;
+        if (undirected) {
+            g.offsets[e.second + 1]++;
+        }
+    }
+    for (int i=0; i<n; i++) {
+        g.offsets[i+1] += g.offsets[i];
+    }
+    g.targets.resize(g.offsets[n]);
+    vector<long long> pos(g.offsets.begin(), g.offsets.end() - 1); // Next free slot of each node
+    for (const pi &e : edges) {
+        g.targets[pos[e.first]++] = e.second;
+        if (undirected) {
+            g.targets[pos[e.second]++] = e.first;
+        }
+    }
+    return makeCSR(move(g.offsets), move(g.targets), move(g.weights));
+}
+
+// Same as above for weighted edges, each structured as (length, (start, end))
+inline CSRGraph buildCSR(int n, const vector<pair<int,pi>> &edges, bool undirected = false) {
+    CSRArrays g;
+    g.offsets.assign(n + 1, 0);
+    for (const pair<int,pi> &e : edges) {
+        g.offsets[e.second.first + 1]++;
+        if (undirected) {
+            g.offsets[e.second.second + 1]++;
+        }
+    }
+    for (int i=0; i<n; i++) {
+        g.offsets[i+1] += g.offsets[i];
+    }
+    g.targets.resize(g.offsets[n]);
+    g.weights.resize(g.offsets[n]);
+    vector<long long> pos(g.offsets.begin(), g.offsets.end() - 1);
+    long long slot;
+    for (const pair<int,pi> &e : edges) {
+        slot = pos[e.second.first]++;
+        g.targets[slot] = e.second.second;
+        g.weights[slot] = e.first;
+        if (undirected) {
+            slot = pos[e.second.second]++;
+            g.targets[slot] = e.second.first;
+            g.weights[slot] = e.first;
+        }
+    }
+    return makeCSR(move(g.offsets), move(g.targets), move(g.weights));
+}
+
+// Returns the transpose of g, which holds the edge (v, u) with the same length for every edge (u, v) of g
+// Runs in O(n+m) time
+inline CSRGraph transposeCSR(const CSRGraph &g) {
+    int n = g.size();
+    CSRArrays t;
+    t.offsets.assign(n + 1, 0);
+    for (long long i=0; i<g.numEdges(); i++) {
+        t.offsets[g.targets[i] + 1]++;
+    }
+    for (int i=0; i<n; i++) {
+        t.offsets[i+1] += t.offsets[i];
+    }
+    t.targets.resize(g.numEdges());
+    t.weights.resize(g.hasWeights() ? g.numEdges() : 0);
+    vector<long long> pos(t.offsets.begin(), t.offsets.end() - 1);
+    for (int u=0; u<n; u++) {
+        for (long long i=g.offsets[u]; i<g.offsets[u+1]; i++) {
+            long long slot = pos[g.targets[i]]++;
+            t.targets[slot] = u;
+            if (g.hasWeights()) {
+                t.weights[slot] = g.weights[i];
+            }
+        }
+    }
+    return makeCSR(move(t.offsets), move(t.targets), move(t.weights));
+}
+
+// Converts adjacency lists into CSR form, keeping the order of each list
+inline CSRGraph toCSR(const vector<vector<int>> &l) {
+    CSRArrays g;
+    g.offsets.assign(l.size() + 1, 0);
+    for (size_t i=0; i<l.size(); i++) {
+        g.offsets[i+1] = g.offsets[i] + l[i].size();
+    }
+    g.targets.reserve(g.offsets.back());
+    for (const vector<int> &v : l) {
+        g.targets.insert(g.targets.end(), v.begin(), v.end());
+    }
+    return makeCSR(move(g.offsets), move(g.targets), move(g.weights));
+}
+
+// Converts weighted adjacency lists of (node, distance) pairs into CSR form
+inline CSRGraph toCSR(const vector<vector<pi>> &l) {
+    CSRArrays g;
+    g.offsets.assign(l.size() + 1, 0);
+    for (size_t i=0; i<l.size(); i++) {
+        g.offsets[i+1] = g.offsets[i] + l[i].size();
+    }
+    g.targets.reserve(g.offsets.back());
+    g.weights.reserve(g.offsets.back());
+    for (const vector<pi> &v : l) {
+        for (const pi &p : v) {
+            g.targets.push_back(p.first);
+            g.weights.push_back(p.second);
+        }
+    }
+    return makeCSR(move(g.offsets), move(g.targets), move(g.weights));
+}
+
+#endif
@@ -1,10 +1,16 @@
 // Algorithms related to directed graphs
 // Graphs are represented with adjacency lists with n nodes as distinct ints from 0 to n-1
+// Every algorithm takes its graph by const reference and accepts either adjacency lists or a CSRGraph
 
 #include <iostream>
 #include <vector>
 #include <stack>
 #include <queue>
+#include <algorithm>
+#include <climits>
+#include <atomic>
+#include "csr_graph.h"
+#include "parallel.h"
 
 using namespace std;
 
@@ -17,13 +23,14 @@ typedef vector<vector<pi>> weighted_graph; // (node,distance) pairs
 // Returns a topological order of a DAG, or an empty vector if the input is not a DAG
 // The graph is not required to be connected
 
-vector<int> topologicalOrder (adjList l) {
+template <typename G>
+vector<int> topologicalOrder (const G &l) {
     vector<int> to;
     vector<int> activePre(l.size());
     queue<int> leadingNodes;
     // Preprocessing
-    for (vector<int> v : l) {
-        for (int node : v) {
+    for (int i=0; i<l.size(); i++) {
+        for (int node : l[i]) {
             activePre[node]++;
         }
     }
@@ -60,7 +67,8 @@ vector<int> topologicalOrder (adjList l) {
 // Returns a vector of vectors, each of which contains an SCC
 // Iterative version
 
-vector<vector<int>> getSCC (graph g) {
+template <typename G>
+vector<vector<int>> getSCC (const G &g) {
     
     // A slightly modified DFS procedure on g to order nodes by finishing time
     stack<int> s;
@@ -147,7 +155,8 @@ vector<vector<int>> getSCC (graph g) {
 // Returns a vector of vectors, each of which contains an SCC
 // Iterative version
 
-vector<vector<int>> getSCC2 (graph g) {
+template <typename G>
+vector<vector<int>> getSCC2 (const G &g) {
     vector<vector<int>> SCC;
     vector<int> curSet;
     stack<int> s1; // Standard DFS stack
@@ -218,7 +227,8 @@ vector<vector<int>> getSCC2 (graph g) {
 //  whose i-th index holds the shortest distance from the source to the i-th node.
 // Runs in O(mlogn) time
 
-vector<int> shortestDistance(weighted_graph g, int source) {
+template <typename G>
+vector<int> shortestDistance(const G &g, int source) {
     vector<int> explored(g.size());
     vector<int> shortestDistance(g.size(), -1);
     // pi.second is a node i and p.first is the shortest distance from source to i based on current explored set
@@ -264,3 +274,825 @@ vector<int> shortestDistance(weighted_graph g, int source) {
 // Refer to the union-find template for implementation.
 
 // ----------------------------------------------------------------------------------------------------------
+
+
+// 6. PARALLEL TOPOLOGICAL SORTING BY LEVELS ----------------------------------------------------------------
+
+// Kahn's algorithm processed one wavefront at a time on a CSR graph. All nodes of a wavefront are independent,
+//  so their out-edges are handled concurrently and in-degrees are decremented atomically. The thread that brings
+//  a node's in-degree to zero places it in the next wavefront.
+// Returns a topological order together with the level of every node: level 0 holds the nodes without
+//  predecessors, and every node sits one level below its latest predecessor, so each level can be dispatched as
+//  one wave of independent tasks. Both vectors are empty if the input is not a DAG.
+// Runs in O(n+m) work
+
+struct TopoLevels {
+    vector<int> order; // Sorted by level
+    vector<int> level;
+};
+
+TopoLevels parallelTopologicalOrder(const CSRGraph &g, int numThreads = defaultThreads()) {
+    int n = g.size();
+    numThreads = max(1, numThreads);
+    TopoLevels res {{}, vector<int>(n, -1)};
+    vector<atomic<int>> activePre(n);
+    for (int i=0; i<n; i++) {
+        activePre[i].store(0, memory_order_relaxed);
+    }
+    parallelFor(0, n, [&](long long u) {
+        for (int node : g[u]) {
+            activePre[node].fetch_add(1, memory_order_relaxed);
+        }
+    }, numThreads, 1024);
+    
+    vector<vector<int>> localNext(numThreads);
+    parallelForChunks(0, n, [&](long long lo, long long hi, int t) {
+        for (long long i=lo; i<hi; i++) {
+            if (activePre[i].load(memory_order_relaxed) == 0) {
+                localNext[t].push_back((int)i);
+            }
+        }
+    }, numThreads);
+    
+    res.order.reserve(n);
+    size_t begin = 0; // The current wavefront is order[begin] to the end of order
+    for (int lv=0; ; lv++) {
+        for (int t=0; t<numThreads; t++) {
+            res.order.insert(res.order.end(), localNext[t].begin(), localNext[t].end());
+            localNext[t].clear();
+        }
+        if (begin == res.order.size()) {
+            break;
+        }
+        parallelForChunks(begin, (long long)res.order.size(), [&](long long lo, long long hi, int t) {
+            for (long long i=lo; i<hi; i++) {
+                int cur = res.order[i];
+                res.level[cur] = lv;
+                for (int node : g[cur]) {
+                    if (activePre[node].fetch_sub(1, memory_order_acq_rel) == 1) {
+                        localNext[t].push_back(node);
+                    }
+                }
+            }
+        }, numThreads, 64);
+        begin = res.order.size();
+    }
+    
+    // Checking against cycles
+    if (res.order.size() < (size_t)n) {
+        return TopoLevels();
+    }
+    return res;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+
+// 7. PARALLEL STRONGLY CONNECTED COMPONENTS ----------------------------------------------------------------
+
+// Multistep SCC (Slota et al.) on a CSR graph and its transpose
+// 1. Trim: a node with no remaining predecessor or successor is an SCC by itself
+// 2. Forward-backward: the nodes both reachable from and reaching a high-degree pivot form its SCC, which is
+//     usually the giant one. Both searches are parallel BFS.
+// 3. Coloring: every remaining node starts with its own id as color and the largest color is propagated along
+//     edges in parallel. A node that keeps its own color is a root, and a parallel backward BFS from all roots
+//     at once, restricted to nodes of the root's color, collects its SCC. This repeats until no node is left.
+// 4. Serial finish: on a long chain of SCCs a round labels a single SCC while colors crawl down the whole chain.
+//     An iterative Tarjan over the unlabelled nodes takes over once few nodes are left, once a round labels
+//     under 1% of them, or once a propagation pushes more than 4 nodes per remaining node.
+// Returns the SCC label of every node. Two nodes are in the same SCC iff they have the same label.
+// Pass the transpose if it is already at hand; otherwise it is built once per call.
+// Runs in O(m) work per BFS level or propagation step
+
+// Parallel BFS from the nodes in frontier over nodes without a label, setting mark on every node reached
+void sccReach(const CSRGraph &g, vector<int> frontier, vector<atomic<int>> &label, vector<atomic<char>> &mark,
+              int numThreads) {
+    numThreads = max(1, numThreads);
+    vector<vector<int>> localNext(numThreads);
+    while (!frontier.empty()) {
+        parallelForChunks(0, (long long)frontier.size(), [&](long long lo, long long hi, int t) {
+            for (long long i=lo; i<hi; i++) {
+                for (int node : g[frontier[i]]) {
+                    char expected = 0;
+                    if (label[node].load(memory_order_relaxed) == -1 && mark[node].load(memory_order_relaxed) == 0 &&
+                        mark[node].compare_exchange_strong(expected, 1, memory_order_relaxed)) {
+                        localNext[t].push_back(node);
+                    }
+                }
+            }
+        }, numThreads, 64);
+        frontier.clear();
+        for (int t=0; t<numThreads; t++) {
+            frontier.insert(frontier.end(), localNext[t].begin(), localNext[t].end());
+            localNext[t].clear();
+        }
+    }
+}
+
+// Iterative Tarjan over the subgraph of nodes without a label. Each SCC is labelled with the id of its
+//  first-visited node.
+void sccSerial(const CSRGraph &g, vector<atomic<int>> &label) {
+    int n = g.size();
+    vector<int> order(n, -1); // Visiting order
+    vector<int> low(n); // The earliest-visited node still on the stack reachable from each node
+    vector<pi> s1; // DFS stack of (node, index of the next edge to examine)
+    vector<int> s2; // Visited nodes not yet assigned to an SCC, in visiting order
+    int cnt = 0;
+    for (int root=0; root<n; root++) {
+        if (order[root] != -1 || label[root].load(memory_order_relaxed) != -1) {
+            continue;
+        }
+        order[root] = low[root] = cnt++;
+        s1.push_back({root, 0});
+        s2.push_back(root);
+        while (!s1.empty()) {
+            int cur = s1.back().first;
+            if (s1.back().second < g.degree(cur)) {
+                int node = g[cur][s1.back().second++];
+                if (label[node].load(memory_order_relaxed) != -1) { // Outside the subgraph or already in an SCC
+                    continue;
+                }
+                if (order[node] == -1) {
+                    order[node] = low[node] = cnt++;
+                    s1.push_back({node, 0});
+                    s2.push_back(node);
+                } else {
+                    low[cur] = min(low[cur], order[node]);
+                }
+                continue;
+            }
+            s1.pop_back();
+            if (!s1.empty()) {
+                low[s1.back().first] = min(low[s1.back().first], low[cur]);
+            }
+            if (low[cur] == order[cur]) {
+                int node;
+                do {
+                    node = s2.back();
+                    s2.pop_back();
+                    label[node].store(cur, memory_order_relaxed);
+                } while (node != cur);
+            }
+        }
+    }
+}
+
+vector<int> parallelSCC(const CSRGraph &g, const CSRGraph &t, int numThreads = defaultThreads()) {
+    const int trimRounds = 3;
+    const size_t serialBelow = 1 << 12; // Remaining node count under which the coloring hands over to Tarjan
+    numThreads = max(1, numThreads);
+    int n = g.size();
+    vector<atomic<int>> label(n);
+    for (int i=0; i<n; i++) {
+        label[i].store(-1, memory_order_relaxed);
+    }
+    
+    // 1. Trim
+    for (int r=0; r<trimRounds; r++) {
+        atomic<int> trimmed(0);
+        parallelFor(0, n, [&](long long v) {
+            if (label[v].load(memory_order_relaxed) != -1) {
+                return;
+            }
+            bool hasIn = false, hasOut = false;
+            for (int node : t[v]) {
+                if (node != v && label[node].load(memory_order_relaxed) == -1) {
+                    hasIn = true;
+                    break;
+                }
+            }
+            for (int node : g[v]) {
+                if (!hasIn) {
+                    break;
+                }
+                if (node != v && label[node].load(memory_order_relaxed) == -1) {
+                    hasOut = true;
+                    break;
+                }
+            }
+            if (!hasIn || !hasOut) {
+                label[v].store((int)v, memory_order_relaxed);
+                trimmed++;
+            }
+        }, numThreads, 1024);
+        if (trimmed == 0) {
+            break;
+        }
+    }
+    
+    // 2. Forward-backward from the remaining node with the largest in-degree * out-degree
+    int pivot = -1;
+    long long best = -1;
+    for (int i=0; i<n; i++) {
+        if (label[i] == -1 && (long long)g.degree(i) * t.degree(i) > best) {
+            best = (long long)g.degree(i) * t.degree(i);
+            pivot = i;
+        }
+    }
+    if (pivot != -1) {
+        vector<atomic<char>> fw(n), bw(n);
+        for (int i=0; i<n; i++) {
+            fw[i].store(0, memory_order_relaxed);
+            bw[i].store(0, memory_order_relaxed);
+        }
+        fw[pivot] = bw[pivot] = 1;
+        sccReach(g, {pivot}, label, fw, numThreads);
+        sccReach(t, {pivot}, label, bw, numThreads);
+        parallelFor(0, n, [&](long long v) {
+            if (fw[v] && bw[v]) {
+                label[v].store(pivot, memory_order_relaxed);
+            }
+        }, numThreads, 4096);
+    }
+    
+    // 3. Coloring
+    vector<atomic<int>> color(n);
+    vector<atomic<char>> queued(n); // Whether a node is already in the next frontier
+    vector<vector<int>> localNext(numThreads);
+    vector<int> frontier;
+    size_t remaining = 0; // Unlabelled nodes at the start of the previous round
+    bool serialFinish = false;
+    while (true) {
+        frontier.clear();
+        for (int i=0; i<n; i++) {
+            if (label[i] == -1) {
+                color[i].store(i, memory_order_relaxed);
+                queued[i].store(0, memory_order_relaxed);
+                frontier.push_back(i);
+            }
+        }
+        if (frontier.empty()) {
+            break;
+        }
+        
+        if (frontier.size() < serialBelow || (remaining > 0 && (remaining - frontier.size()) * 100 < remaining)) {
+            serialFinish = true;
+            break;
+        }
+        remaining = frontier.size();
+        
+        // Propagate the largest color forward until nothing changes. Only nodes whose color just changed need
+        //  to push it further.
+        long long budget = 4 * (long long)remaining; // Pushes left before the round counts as crawling
+        while (!frontier.empty() && budget >= 0) {
+            parallelForChunks(0, (long long)frontier.size(), [&](long long lo, long long hi, int th) {
+                for (long long i=lo; i<hi; i++) {
+                    int u = frontier[i];
+                    queued[u].store(0, memory_order_relaxed);
+                    int c = color[u].load(memory_order_relaxed);
+                    for (int node : g[u]) {
+                        if (label[node].load(memory_order_relaxed) != -1) {
+                            continue;
+                        }
+                        int cur = color[node].load(memory_order_relaxed);
+                        bool raised = false;
+                        while (c > cur && !(raised = color[node].compare_exchange_weak(cur, c, memory_order_relaxed))) {}
+                        char expected = 0;
+                        if (raised && queued[node].compare_exchange_strong(expected, 1, memory_order_relaxed)) {
+                            localNext[th].push_back(node);
+                        }
+                    }
+                }
+            }, numThreads, 64);
+            frontier.clear();
+            for (int th=0; th<numThreads; th++) {
+                frontier.insert(frontier.end(), localNext[th].begin(), localNext[th].end());
+                localNext[th].clear();
+            }
+            budget -= (long long)frontier.size();
+        }
+        if (budget < 0) {
+            serialFinish = true;
+            break;
+        }
+        
+        // Backward BFS from every root at once, staying within the root's color
+        for (int i=0; i<n; i++) {
+            if (label[i] == -1 && color[i] == i) {
+                label[i].store(i, memory_order_relaxed);
+                frontier.push_back(i);
+            }
+        }
+        while (!frontier.empty()) {
+            parallelForChunks(0, (long long)frontier.size(), [&](long long lo, long long hi, int th) {
+                for (long long i=lo; i<hi; i++) {
+                    int u = frontier[i];
+                    int c = color[u].load(memory_order_relaxed);
+                    for (int node : t[u]) {
+                        int expected = -1;
+                        if (color[node].load(memory_order_relaxed) == c && label[node].load(memory_order_relaxed) == -1 &&
+                            label[node].compare_exchange_strong(expected, c, memory_order_relaxed)) {
+                            localNext[th].push_back(node);
+                        }
+                    }
+                }
+            }, numThreads, 64);
+            frontier.clear();
+            for (int th=0; th<numThreads; th++) {
+                frontier.insert(frontier.end(), localNext[th].begin(), localNext[th].end());
+                localNext[th].clear();
+            }
+        }
+    }
+    
+    // 4. Serial finish
+    if (serialFinish) {
+        sccSerial(g, label);
+    }
+    
+    vector<int> res(n);
+    for (int i=0; i<n; i++) {
+        res[i] = label[i];
+    }
+    return res;
+}
+
+vector<int> parallelSCC(const CSRGraph &g, int numThreads = defaultThreads()) {
+    return parallelSCC(g, transposeCSR(g), numThreads);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+
+// 8. DELTA-STEPPING PARALLEL SHORTEST PATHS ----------------------------------------------------------------
+
+// Delta-stepping (Meyer and Sanders) on a CSR graph with non-negative edge lengths
+// Nodes wait in buckets of width delta by tentative distance. The smallest non-empty bucket is settled in
+//  phases: light edges (length <= delta) of its nodes are relaxed in parallel, which may refill the same bucket,
+//  until it stays empty. Heavy edges can never land in the current bucket, so they are relaxed once per bucket
+//  afterwards. Relaxations are atomic min updates on 64-bit distances.
+// Buckets are kept in a ring of at most L/delta+2 slots for the largest length L, capped at 2^16, and buckets a
+//  multiple of the ring size apart share a slot. A min-heap holds the smallest bucket of every non-empty slot,
+//  so runs of empty buckets are skipped rather than walked.
+// Returns a vector whose i-th index holds the shortest distance from the source to the i-th node, or -1 if
+//  unreachable. delta <= 0 picks (largest length) / (average degree), at least 1.
+// Runs in O(n + m + phases + U log U) work for U distance updates
+
+vector<long long> deltaStepping(const CSRGraph &g, int source, long long delta = 0,
+                                int numThreads = defaultThreads()) {
+    numThreads = max(1, numThreads);
+    int n = g.size();
+    long long maxLen = 0;
+    for (long long i=0; i<g.numEdges(); i++) {
+        maxLen = max(maxLen, (long long)(g.hasWeights() ? g.weights[i] : 1));
+    }
+    if (delta <= 0) {
+        delta = max(1LL, g.numEdges() ? maxLen * n / g.numEdges() : 1);
+    }
+    const long long INF = LLONG_MAX;
+    vector<atomic<long long>> dist(n);
+    for (int i=0; i<n; i++) {
+        dist[i].store(INF, memory_order_relaxed);
+    }
+    
+    long long numBuckets = min(maxLen / delta + 2, 1LL << 16);
+    vector<vector<int>> buckets(numBuckets); // Bucket b lives in slot b % numBuckets
+    vector<long long> slotMin(numBuckets, INF); // Smallest bucket pushed to next for each slot
+    priority_queue<long long, vector<long long>, greater<long long>> next; // Buckets to settle, may repeat
+    vector<vector<int>> localUpdates(numThreads); // Nodes whose distance dropped, per thread
+    vector<int> inPhase(n, -1); // Last phase a node was taken from a bucket, to drop duplicates
+    vector<long long> inSettled(n, -1); // Last bucket a node was settled in
+    vector<int> frontier, settled, later;
+    int phase = 0;
+    
+    // Files v by its current tentative distance. Older entries become stale.
+    auto file = [&](int v) {
+        long long b = dist[v].load(memory_order_relaxed) / delta;
+        long long slot = b % numBuckets;
+        buckets[slot].push_back(v);
+        if (b < slotMin[slot]) {
+            slotMin[slot] = b;
+            next.push(b);
+        }
+    };
+    
+    // Relaxes every edge of the nodes in list whose length is light or heavy as requested
+    auto relaxAll = [&](const vector<int> &list, bool light) {
+        parallelForChunks(0, (long long)list.size(), [&](long long lo, long long hi, int t) {
+            for (long long i=lo; i<hi; i++) {
+                int u = list[i];
+                long long du = dist[u].load(memory_order_relaxed);
+                for (pi p : g[u]) {
+                    if ((p.second <= delta) != light) {
+                        continue;
+                    }
+                    long long nd = du + p.second;
+                    long long cur = dist[p.first].load(memory_order_relaxed);
+                    bool lowered = false;
+                    while (nd < cur && !(lowered = dist[p.first].compare_exchange_weak(cur, nd, memory_order_relaxed))) {}
+                    if (lowered) {
+                        localUpdates[t].push_back(p.first);
+                    }
+                }
+            }
+        }, numThreads, 64);
+        for (int t=0; t<numThreads; t++) {
+            for (int v : localUpdates[t]) {
+                file(v);
+            }
+            localUpdates[t].clear();
+        }
+    };
+    
+    dist[source] = 0;
+    file(source);
+    long long b = -1; // Last settled bucket
+    while (!next.empty()) {
+        if (next.top() <= b) { // Repeated entry of a settled bucket
+            next.pop();
+            continue;
+        }
+        b = next.top();
+        next.pop();
+        long long slot = b % numBuckets;
+        vector<int> &bucket = buckets[slot];
+        settled.clear();
+        later.clear();
+        while (!bucket.empty()) {
+            // Take the bucket's current entries, dropping stale and duplicate ones and setting aside later laps
+            frontier.clear();
+            phase++;
+            for (int v : bucket) {
+                long long d = dist[v].load(memory_order_relaxed) / delta;
+                if (d < b || d % numBuckets != slot || inPhase[v] == phase) {
+                    continue;
+                }
+                inPhase[v] = phase;
+                if (d > b) {
+                    later.push_back(v);
+                    continue;
+                }
+                frontier.push_back(v);
+                if (inSettled[v] != b) {
+                    inSettled[v] = b;
+                    settled.push_back(v);
+                }
+            }
+            bucket.clear();
+            relaxAll(frontier, true);
+        }
+        relaxAll(settled, false);
+        
+        // Only later laps are left in the slot. Register the smallest of them.
+        bucket.insert(bucket.end(), later.begin(), later.end());
+        slotMin[slot] = INF;
+        size_t kept = 0;
+        phase++;
+        for (int v : bucket) {
+            long long d = dist[v].load(memory_order_relaxed) / delta;
+            if (d > b && d % numBuckets == slot && inPhase[v] != phase) {
+                inPhase[v] = phase;
+                bucket[kept++] = v;
+                slotMin[slot] = min(slotMin[slot], d);
+            }
+        }
+        bucket.resize(kept);
+        if (kept > 0) {
+            next.push(slotMin[slot]);
+        }
+    }
+    
+    vector<long long> res(n);
+    for (int i=0; i<n; i++) {
+        long long d = dist[i].load(memory_order_relaxed);
+        res[i] = d == INF ? -1 : d;
+    }
+    return res;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+
+// 9. POINT-TO-POINT SHORTEST PATHS: BIDIRECTIONAL DIJKSTRA AND A* ------------------------------------------
+
+// For queries that only need one target. Both searches stop as soon as the answer is known instead of settling
+//  the whole graph, and the path is rebuilt from parent pointers.
+// Edge lengths must be non-negative. Distances are 64-bit.
+
+struct ShortestPath {
+    long long dist; // -1 if the target is unreachable
+    vector<int> path; // From source to target, empty if unreachable
+};
+
+// Returns the transpose of a weighted graph given as adjacency lists, for the backward search
+weighted_graph reverseGraph(const weighted_graph &g) {
+    weighted_graph rev(g.size());
+    for (int i=0; i<(int)g.size(); i++) {
+        for (pi p : g[i]) {
+            rev[p.first].push_back(make_pair(i, p.second));
+        }
+    }
+    return rev;
+}
+
+// Bidirectional Dijkstra: a forward search from the source on g and a backward search from the target on its
+//  transpose rev, always advancing the side whose next node is closer. mu is the length of the best path seen
+//  through an edge joining the two searches. Once the two queue minimums add up to at least mu, no shorter path
+//  can exist and the search stops.
+// For CSR graphs, rev is transposeCSR(g); for adjacency lists, reverseGraph(g)
+// Runs in O(mlogn) time in the worst case, and typically settles a fraction of the nodes
+template <typename G>
+ShortestPath bidirectionalDijkstra(const G &g, const G &rev, int source, int target) {
+    typedef pair<long long,int> pli;
+    const long long INF = LLONG_MAX;
+    int n = (int)g.size();
+    vector<long long> dist[2] = {vector<long long>(n, INF), vector<long long>(n, INF)}; // 0: forward, 1: backward
+    vector<int> parent[2] = {vector<int>(n, -1), vector<int>(n, -1)};
+    vector<char> settled[2] = {vector<char>(n), vector<char>(n)};
+    priority_queue<pli, vector<pli>, greater<pli>> pq[2];
+    dist[0][source] = 0;
+    dist[1][target] = 0;
+    pq[0].push(make_pair(0, source));
+    pq[1].push(make_pair(0, target));
+    long long mu = source == target ? 0 : INF;
+    int meet = source == target ? source : -1;
+    
+    while (!pq[0].empty() && !pq[1].empty() && pq[0].top().first + pq[1].top().first < mu) {
+        int side = pq[0].top().first <= pq[1].top().first ? 0 : 1;
+        int cur = pq[side].top().second;
+        pq[side].pop();
+        if (settled[side][cur]) {
+            continue;
+        }
+        settled[side][cur] = 1;
+        for (pi p : (side == 0 ? g[cur] : rev[cur])) {
+            long long nd = dist[side][cur] + p.second;
+            if (nd < dist[side][p.first]) {
+                dist[side][p.first] = nd;
+                parent[side][p.first] = cur;
+                pq[side].push(make_pair(nd, p.first));
+            }
+            // The other search has reached p.first, which joins the two into a source-target path
+            if (dist[1-side][p.first] != INF && nd + dist[1-side][p.first] < mu) {
+                mu = nd + dist[1-side][p.first];
+                meet = p.first;
+            }
+        }
+    }
+    
+    ShortestPath res {-1, {}};
+    if (meet == -1) {
+        return res;
+    }
+    res.dist = mu;
+    for (int v = meet; v != -1; v = parent[0][v]) {
+        res.path.push_back(v);
+    }
+    reverse(res.path.begin(), res.path.end());
+    for (int v = parent[1][meet]; v != -1; v = parent[1][v]) {
+        res.path.push_back(v);
+    }
+    return res;
+}
+
+// A* search guided by a caller-supplied heuristic h(node), a lower bound on the distance from node to target
+// Nodes are expanded by dist + h. With an admissible h, the target's distance is final when it is popped.
+//  Nodes may be reopened if h is admissible but not consistent.
+// With h = 0 this is Dijkstra with early termination
+template <typename G, typename H>
+ShortestPath aStar(const G &g, int source, int target, H h) {
+    typedef pair<long long,int> pli;
+    const long long INF = LLONG_MAX;
+    int n = (int)g.size();
+    vector<long long> dist(n, INF);
+    vector<int> parent(n, -1);
+    priority_queue<pli, vector<pli>, greater<pli>> pq; // (dist + h, node)
+    dist[source] = 0;
+    pq.push(make_pair((long long)h(source), source));
+    int cur;
+    
+    while (!pq.empty()) {
+        cur = pq.top().second;
+        long long key = pq.top().first;
+        pq.pop();
+        if (key > dist[cur] + (long long)h(cur)) {
+            continue; // Stale entry
+        }
+        if (cur == target) {
+            break;
+        }
+        for (pi p : g[cur]) {
+            long long nd = dist[cur] + p.second;
+            if (nd < dist[p.first]) {
+                dist[p.first] = nd;
+                parent[p.first] = cur;
+                pq.push(make_pair(nd + (long long)h(p.first), p.first));
+            }
+        }
+    }
+    
+    ShortestPath res {-1, {}};
+    if (dist[target] == INF) {
+        return res;
+    }
+    res.dist = dist[target];
+    for (int v = target; v != -1; v = parent[v]) {
+        res.path.push_back(v);
+    }
+    reverse(res.path.begin(), res.path.end());
+    return res;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+
+// 10. BATCHED SHORTEST PATHS WITH A REUSABLE WORKSPACE -----------------------------------------------------
+
+// Dijkstra for callers that run many sources on the same graph
+// A workspace keeps the distance array, the heap and the list of reached nodes between runs. Each run bumps a
+//  generation number instead of clearing the distances, so it allocates nothing once the buffers have grown and
+//  costs time proportional to the part of the graph it reaches rather than to n.
+// Edge lengths must be non-negative. Distances are 64-bit.
+
+struct DijkstraWorkspace {
+    vector<long long> dist; // Valid only where mark[i] == generation
+    vector<unsigned> mark;
+    unsigned generation = 0;
+    vector<pair<long long,int>> heap; // Binary min-heap of (distance, node), may hold stale entries
+    vector<int> reached; // Nodes settled by the last run, in order of distance
+};
+
+// Starts a new run over a graph of n nodes
+void beginDijkstra(DijkstraWorkspace &ws, int n) {
+    if (ws.mark.size() < (size_t)n) {
+        ws.mark.resize(n, 0);
+        ws.dist.resize(n);
+    }
+    if (++ws.generation == 0) {
+        fill(ws.mark.begin(), ws.mark.end(), 0);
+        ws.generation = 1;
+    }
+    ws.heap.clear();
+    ws.reached.clear();
+}
+
+// Distance from the source of the last run to node, or -1 if unreachable
+long long workspaceDistance(const DijkstraWorkspace &ws, int node) {
+    return ws.mark[node] == ws.generation ? ws.dist[node] : -1;
+}
+
+// Runs Dijkstra from source. Afterwards ws.reached lists every reachable node and workspaceDistance gives its
+//  distance. Runs in O(m' log m') time, where m' is the number of edges leaving reached nodes.
+template <typename G>
+void runDijkstra(const G &g, int source, DijkstraWorkspace &ws) {
+    typedef pair<long long,int> pli;
+    beginDijkstra(ws, (int)g.size());
+    unsigned gen = ws.generation;
+    ws.mark[source] = gen;
+    ws.dist[source] = 0;
+    ws.heap.push_back(make_pair(0, source));
+    while (!ws.heap.empty()) {
+        pop_heap(ws.heap.begin(), ws.heap.end(), greater<pli>());
+        pli cur = ws.heap.back();
+        ws.heap.pop_back();
+        if (cur.first > ws.dist[cur.second]) {
+            continue; // Stale entry
+        }
+        ws.reached.push_back(cur.second);
+        for (pi p : g[cur.second]) {
+            long long nd = cur.first + p.second;
+            if (ws.mark[p.first] != gen || nd < ws.dist[p.first]) {
+                ws.mark[p.first] = gen;
+                ws.dist[p.first] = nd;
+                ws.heap.push_back(make_pair(nd, p.first));
+                push_heap(ws.heap.begin(), ws.heap.end(), greater<pli>());
+            }
+        }
+    }
+}
+
+// Runs Dijkstra from every node in sources on numThreads threads, with one workspace per thread
+// f(i, ws) is called on the worker thread right after the run from sources[i], and reads the results from ws
+//  before the workspace is reused. It must be safe to call concurrently for different i.
+template <typename G, typename F>
+void batchDijkstra(const G &g, const vector<int> &sources, F f, int numThreads = defaultThreads()) {
+    vector<DijkstraWorkspace> workspaces(max(numThreads, 1));
+    parallelForChunks(0, sources.size(), [&](long long lo, long long hi, int t) {
+        for (long long i=lo; i<hi; i++) {
+            runDijkstra(g, sources[i], workspaces[t]);
+            f((int)i, (const DijkstraWorkspace &)workspaces[t]);
+        }
+    }, numThreads, 16);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+
+// 11. DYNAMIC TOPOLOGICAL ORDER UNDER EDGE INSERTIONS ------------------------------------------------------
+
+// Pearce and Kelly's algorithm: maintains a topological order of a DAG while edges are added one at a time
+// An edge u->v that already goes forward in the order needs no work. Otherwise only the nodes with positions
+//  between ord[v] and ord[u] can be out of place: a forward search from v and a backward search from u, both
+//  limited to that window, find them, and they are reassigned the same set of positions with u's ancestors
+//  first. Reaching u from v means the edge would close a cycle, and it is rejected.
+// An insertion costs time proportional to the edges around the affected window, not to the whole graph
+
+struct DynamicTopo {
+    vector<vector<int>> out, in;
+    vector<int> ord; // ord[v] = position of v in the order
+    vector<int> order; // order[i] = node at position i
+    // Search buffers
+    vector<unsigned> mark; // mark[i] == generation iff i was reached by the current insertion
+    unsigned generation = 0;
+    vector<int> parent; // Forward search tree, used to report cycles
+    vector<int> forward, backward, stack, positions;
+};
+
+// Returns an empty graph with n nodes, ordered 0 to n-1
+DynamicTopo makeDynamicTopo(int n) {
+    DynamicTopo dt;
+    dt.out.resize(n);
+    dt.in.resize(n);
+    dt.ord.resize(n);
+    dt.order.resize(n);
+    for (int i=0; i<n; i++) {
+        dt.ord[i] = i;
+        dt.order[i] = i;
+    }
+    dt.mark.assign(n, 0);
+    dt.parent.assign(n, -1);
+    return dt;
+}
+
+// Collects into found the nodes reachable from start through edges of adj whose positions satisfy
+//  lo < ord <= hi. Stops and returns true as soon as stop is reached.
+bool dynamicTopoSearch(DynamicTopo &dt, const vector<vector<int>> &adj, int start, int lo, int hi, int stop,
+                       vector<int> &found) {
+    unsigned gen = dt.generation;
+    found.clear();
+    dt.stack.clear();
+    dt.mark[start] = gen;
+    dt.parent[start] = -1;
+    dt.stack.push_back(start);
+    while (!dt.stack.empty()) {
+        int cur = dt.stack.back();
+        dt.stack.pop_back();
+        found.push_back(cur);
+        for (int node : adj[cur]) {
+            if (dt.mark[node] == gen || dt.ord[node] <= lo || dt.ord[node] > hi) {
+                continue;
+            }
+            dt.mark[node] = gen;
+            dt.parent[node] = cur;
+            if (node == stop) {
+                return true;
+            }
+            dt.stack.push_back(node);
+        }
+    }
+    return false;
+}
+
+// Adds the edge u->v and updates the order. Returns false and leaves the graph unchanged if the edge would
+//  create a cycle, which is then stored in cycle as the path v, ..., u that the edge would close.
+bool addEdge(DynamicTopo &dt, int u, int v, vector<int> &cycle) {
+    cycle.clear();
+    if (u == v) {
+        cycle.push_back(u);
+        return false;
+    }
+    int lb = dt.ord[v], ub = dt.ord[u];
+    if (lb < ub) {
+        if (++dt.generation == 0) {
+            // Marks from 2^32 insertions ago would look current again
+            fill(dt.mark.begin(), dt.mark.end(), 0);
+            dt.generation = 1;
+        }
+        // Forward: nodes reachable from v that precede u. Backward: nodes reaching u that follow v.
+        if (dynamicTopoSearch(dt, dt.out, v, lb, ub, u, dt.forward)) {
+            for (int node = u; node != -1; node = dt.parent[node]) {
+                cycle.push_back(node);
+            }
+            reverse(cycle.begin(), cycle.end());
+            return false;
+        }
+        dynamicTopoSearch(dt, dt.in, u, lb, ub, -1, dt.backward);
+        
+        // Both sets keep their internal order and share their old positions, backward set first
+        auto byOrd = [&](int a, int b) { return dt.ord[a] < dt.ord[b]; };
+        sort(dt.forward.begin(), dt.forward.end(), byOrd);
+        sort(dt.backward.begin(), dt.backward.end(), byOrd);
+        dt.positions.clear();
+        for (int node : dt.backward) {
+            dt.positions.push_back(dt.ord[node]);
+        }
+        for (int node : dt.forward) {
+            dt.positions.push_back(dt.ord[node]);
+        }
+        sort(dt.positions.begin(), dt.positions.end());
+        int i = 0;
+        for (int node : dt.backward) {
+            dt.ord[node] = dt.positions[i];
+            dt.order[dt.positions[i++]] = node;
+        }
+        for (int node : dt.forward) {
+            dt.ord[node] = dt.positions[i];
+            dt.order[dt.positions[i++]] = node;
+        }
+    }
+    dt.out[u].push_back(v);
+    dt.in[v].push_back(u);
+    return true;
+}
+
+// ----------------------------------------------------------------------------------------------------------
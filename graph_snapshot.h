@@ -0,0 +1,346 @@
+// Binary CSR graph snapshots that are memory-mapped and used in place, and a parallel converter from text edge
+//  lists
+//
+// File layout, in native byte order:
+//  header   SnapshotHeader (32 bytes)
+//  offsets  numNodes+1 int64
+//  targets  numEdges int32
+//  weights  numEdges int32, present only if the weighted flag is set
+// Every section starts on a multiple of its element size, so the arrays can be used straight from the mapping.
+
+#ifndef GRAPH_SNAPSHOT_H
+#define GRAPH_SNAPSHOT_H
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <atomic>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "csr_graph.h"
+#include "parallel.h"
+
+using namespace std;
+
+const char SNAPSHOT_MAGIC[8] = {'C','S','R','G','R','A','P','H'};
+const uint32_t SNAPSHOT_VERSION = 1;
+const uint32_t SNAPSHOT_WEIGHTED = 1; // Flag bit
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t numNodes;
+    uint64_t numEdges;
+};
+
+// Total file size of a snapshot with the given header
+inline uint64_t snapshotSize(const SnapshotHeader &h) {
+    uint64_t size = sizeof(SnapshotHeader) + (h.numNodes + 1) * sizeof(int64_t) + h.numEdges * sizeof(int32_t);
+    if (h.flags & SNAPSHOT_WEIGHTED) {
+        size += h.numEdges * sizeof(int32_t);
+    }
+    return size;
+}
+
+// Writes g to path. Returns false if the file cannot be written.
+inline bool saveSnapshot(const CSRGraph &g, const string &path) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+    SnapshotHeader h {};
+    memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+    h.version = SNAPSHOT_VERSION;
+    h.flags = g.hasWeights() ? SNAPSHOT_WEIGHTED : 0;
+    h.numNodes = g.size();
+    h.numEdges = g.numEdges();
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+              fwrite(g.offsets, sizeof(int64_t), h.numNodes + 1, f) == h.numNodes + 1 &&
+              fwrite(g.targets, sizeof(int32_t), h.numEdges, f) == h.numEdges &&
+              (!g.hasWeights() || fwrite(g.weights, sizeof(int32_t), h.numEdges, f) == h.numEdges);
+    return fclose(f) == 0 && ok;
+}
+
+// Maps the snapshot at path read-only and points g into the mapping, without parsing or copying
+// The mapping lives as long as g or any copy of it does
+// Returns false if the file cannot be mapped or is not a valid snapshot of this version. Validating offsets and
+//  targets reads the whole file once, in O(n+m) time.
+inline bool loadSnapshot(const string &path, CSRGraph &g) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        return false;
+    }
+    size_t size = st.st_size;
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping stays valid after the descriptor is closed
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+    // The counts are bounded by the file size before snapshotSize multiplies them, so that it cannot wrap
+    const SnapshotHeader* h = (const SnapshotHeader*)addr;
+    uint64_t body = size - sizeof(SnapshotHeader);
+    if (memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic)) != 0 || h->version != SNAPSHOT_VERSION ||
+        h->numNodes >= (uint64_t)INT32_MAX || h->numNodes + 1 > body / sizeof(int64_t) ||
+        h->numEdges > body / sizeof(int32_t) || snapshotSize(*h) != size) {
+        munmap(addr, size);
+        return false;
+    }
+
+    const char* p = (const char*)addr + sizeof(SnapshotHeader);
+    int n = (int)h->numNodes;
+    long long m = (long long)h->numEdges;
+    const long long* offsets = (const long long*)p;
+    p += (h->numNodes + 1) * sizeof(int64_t);
+    const int* targets = (const int*)p;
+    p += h->numEdges * sizeof(int32_t);
+
+    // Structural checks, so that a corrupt file cannot send the algorithms out of bounds
+    bool valid = offsets[0] == 0 && offsets[n] == m;
+    for (int i=0; i<n && valid; i++) {
+        valid = offsets[i] <= offsets[i+1];
+    }
+    for (long long i=0; i<m && valid; i++) {
+        valid = targets[i] >= 0 && targets[i] < n;
+    }
+    if (!valid) {
+        munmap(addr, size);
+        return false;
+    }
+
+    g.n = n;
+    g.m = m;
+    g.offsets = offsets;
+    g.targets = targets;
+    g.weights = (h->flags & SNAPSHOT_WEIGHTED) ? (const int*)p : nullptr;
+    g.storage = shared_ptr<void>(addr, [size](void* a) { munmap(a, size); });
+    return true;
+}
+
+// Parses the ints in [p, end) into one line's fields, with an optional '-' sign directly before the digits
+// Returns the number of fields, or -1 if a field lies outside the int range
+inline int parseEdgeLine(const char* &p, const char* end, long long fields[3]) {
+    int count = 0;
+    bool inRange = true;
+    while (p < end && *p != '\n') {
+        if (*p == '#' || *p == '%') { // Comment until end of line
+            while (p < end && *p != '\n') {
+                p++;
+            }
+            break;
+        }
+        bool negative = *p == '-' && p + 1 < end && p[1] >= '0' && p[1] <= '9';
+        if (negative) {
+            p++;
+        }
+        if (*p >= '0' && *p <= '9') {
+            long long x = 0;
+            while (p < end && *p >= '0' && *p <= '9') {
+                x = min(x * 10 + (*p++ - '0'), (long long)INT32_MAX + 2); // Saturate rather than overflow
+            }
+            x = negative ? -x : x;
+            inRange = inRange && x >= INT32_MIN && x <= INT32_MAX;
+            if (count < 3) {
+                fields[count] = x;
+            }
+            count++;
+        } else {
+            p++;
+        }
+    }
+    if (p < end) {
+        p++; // Skip '\n'
+    }
+    return inRange ? count : -1;
+}
+
+// Converts a text edge list with one "start end" or "start end length" line per edge into a snapshot
+// Lines starting with '#' or '%' are comments. The graph is weighted if the first edge line has a length.
+// n is one more than the largest node id. Each edge is stored in both directions if undirected is set.
+// Parsing, degree counting and scattering run on numThreads threads, and the output is written in place
+//  through a writable mapping of the snapshot file. Each node's edges are then sorted by target and length, so
+//  the file does not depend on thread timing.
+// Returns false on I/O errors, negative node ids, and values outside the int range
+inline bool convertEdgeList(const string &textPath, const string &snapshotPath, bool undirected = false,
+                            int numThreads = defaultThreads()) {
+    // Map the input
+    int fd = open(textPath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    size_t textSize = st.st_size;
+    const char* text = textSize ? (const char*)mmap(nullptr, textSize, PROT_READ, MAP_PRIVATE, fd, 0) : "";
+    close(fd);
+    if (text == MAP_FAILED) {
+        return false;
+    }
+
+    // Cut the text into chunks that start at line beginnings
+    numThreads = max(1, numThreads);
+    int numChunks = numThreads * 8;
+    vector<size_t> cut(numChunks + 1, textSize);
+    cut[0] = 0;
+    for (int i=1; i<numChunks; i++) {
+        size_t pos = max(cut[i-1], textSize / numChunks * i);
+        while (pos > 0 && pos < textSize && text[pos-1] != '\n') {
+            pos++;
+        }
+        cut[i] = pos;
+    }
+
+    // Decide whether the list is weighted from its first edge line
+    bool weighted = false;
+    for (const char* p = text; p < text + textSize;) {
+        long long fields[3];
+        int count = parseEdgeLine(p, text + textSize, fields);
+        if (count >= 2) {
+            weighted = count >= 3;
+            break;
+        }
+    }
+
+    // Parse chunks in parallel. Each edge is stored as (start, end) with its length alongside.
+    vector<vector<pi>> edges(numChunks);
+    vector<vector<int>> lengths(numChunks);
+    vector<int> maxId(numChunks, -1);
+    atomic<bool> invalid(false);
+    parallelFor(0, numChunks, [&](long long c) {
+        const char* p = text + cut[c];
+        const char* end = text + cut[c+1];
+        long long fields[3];
+        while (p < end) {
+            int count = parseEdgeLine(p, end, fields);
+            bool badId = count >= 2 && (fields[0] < 0 || fields[1] < 0 || max(fields[0], fields[1]) >= INT32_MAX);
+            if (count == -1 || badId) {
+                invalid.store(true, memory_order_relaxed);
+                return;
+            }
+            if (count < 2) {
+                continue;
+            }
+            edges[c].push_back(make_pair((int)fields[0], (int)fields[1]));
+            if (weighted) {
+                lengths[c].push_back(count >= 3 ? (int)fields[2] : 1);
+            }
+            maxId[c] = max(maxId[c], (int)max(fields[0], fields[1]));
+        }
+    }, numThreads);
+    if (textSize) {
+        munmap((void*)text, textSize);
+    }
+    if (invalid) {
+        return false;
+    }
+
+    int n = 0;
+    for (int c=0; c<numChunks; c++) {
+        n = max(n, maxId[c] + 1);
+    }
+
+    // Count degrees in parallel
+    vector<atomic<long long>> cursor(n + 1); // Degree counts, then the next free slot of each node
+    for (int i=0; i<=n; i++) {
+        cursor[i].store(0, memory_order_relaxed);
+    }
+    parallelFor(0, numChunks, [&](long long c) {
+        for (const pi &e : edges[c]) {
+            cursor[e.first].fetch_add(1, memory_order_relaxed);
+            if (undirected) {
+                cursor[e.second].fetch_add(1, memory_order_relaxed);
+            }
+        }
+    }, numThreads);
+
+    // Create the output file at its final size and map it writable
+    SnapshotHeader h {};
+    memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+    h.version = SNAPSHOT_VERSION;
+    h.flags = weighted ? SNAPSHOT_WEIGHTED : 0;
+    h.numNodes = n;
+    h.numEdges = 0;
+    for (int i=0; i<n; i++) {
+        h.numEdges += cursor[i];
+    }
+    size_t outSize = snapshotSize(h);
+    fd = open(snapshotPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    if (ftruncate(fd, outSize) != 0) {
+        close(fd);
+        return false;
+    }
+    char* out = (char*)mmap(nullptr, outSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (out == MAP_FAILED) {
+        return false;
+    }
+    memcpy(out, &h, sizeof(h));
+    long long* offsets = (long long*)(out + sizeof(h));
+    int* targets = (int*)(offsets + n + 1);
+    int* weights = targets + h.numEdges;
+
+    // Prefix sums give the offsets. Then scatter edges in parallel, claiming slots with fetch_add.
+    offsets[0] = 0;
+    for (int i=0; i<n; i++) {
+        offsets[i+1] = offsets[i] + cursor[i];
+        cursor[i].store(offsets[i], memory_order_relaxed);
+    }
+    parallelFor(0, numChunks, [&](long long c) {
+        for (size_t i=0; i<edges[c].size(); i++) {
+            const pi &e = edges[c][i];
+            long long slot = cursor[e.first].fetch_add(1, memory_order_relaxed);
+            targets[slot] = e.second;
+            if (weighted) {
+                weights[slot] = lengths[c][i];
+            }
+            if (undirected) {
+                slot = cursor[e.second].fetch_add(1, memory_order_relaxed);
+                targets[slot] = e.first;
+                if (weighted) {
+                    weights[slot] = lengths[c][i];
+                }
+            }
+        }
+    }, numThreads);
+
+    // Slots were claimed in whatever order the threads got there. Sort every node's edges to fix the order.
+    vector<vector<pi>> buf(numThreads); // (target, length) pairs of the node being sorted, per thread
+    parallelForChunks(0, n, [&](long long lo, long long hi, int t) {
+        for (long long u=lo; u<hi; u++) {
+            if (!weighted) {
+                sort(targets + offsets[u], targets + offsets[u+1]);
+                continue;
+            }
+            buf[t].clear();
+            for (long long i=offsets[u]; i<offsets[u+1]; i++) {
+                buf[t].push_back(make_pair(targets[i], weights[i]));
+            }
+            sort(buf[t].begin(), buf[t].end());
+            for (long long i=offsets[u]; i<offsets[u+1]; i++) {
+                targets[i] = buf[t][i - offsets[u]].first;
+                weights[i] = buf[t][i - offsets[u]].second;
+            }
+        }
+    }, numThreads, 1024);
+
+    bool ok = msync(out, outSize, MS_SYNC) == 0;
+    return munmap(out, outSize) == 0 && ok;
+}
+
+#endif
@@ -0,0 +1,126 @@
+// Minimal shared-memory parallelism helpers built on std::thread
+// Work is handed out dynamically in chunks so that uneven iterations still balance across threads
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+using namespace std;
+
+// Number of worker threads used when the caller does not specify one
+inline int defaultThreads() {
+    int n = (int)thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+// Calls f(lo, hi, t) on consecutive chunks [lo, hi) covering [begin, end) using up to numThreads threads
+// Chunks are claimed grain indices at a time from a shared counter, so f must be safe to run concurrently.
+//  t < numThreads identifies the calling thread so that f can keep thread-local buffers.
+template <typename F>
+void parallelForChunks(long long begin, long long end, F f, int numThreads = defaultThreads(), long long grain = 1024) {
+    if (end <= begin) {
+        return;
+    }
+    numThreads = (int)max<long long>(1, min<long long>(numThreads, (end - begin + grain - 1) / grain));
+    if (numThreads == 1) {
+        f(begin, end, 0);
+        return;
+    }
+    atomic<long long> next(begin);
+    auto worker = [&](int t) {
+        long long lo;
+        while ((lo = next.fetch_add(grain)) < end) {
+            f(lo, min(lo + grain, end), t);
+        }
+    };
+    vector<thread> pool;
+    for (int t=1; t<numThreads; t++) {
+        pool.emplace_back(worker, t);
+    }
+    worker(0); // The calling thread takes part as well
+    for (thread &th : pool) {
+        th.join();
+    }
+}
+
+// Calls f(i) for every i in [begin, end) using up to numThreads threads
+template <typename F>
+void parallelFor(long long begin, long long end, F f, int numThreads = defaultThreads(), long long grain = 1) {
+    parallelForChunks(begin, end, [&](long long lo, long long hi, int) {
+        for (long long i=lo; i<hi; i++) {
+            f(i);
+        }
+    }, numThreads, grain);
+}
+
+// Sorts v[begin, end) by comp using up to numThreads threads
+// The range is cut into one block per thread, the blocks are sorted concurrently, then merged pairwise in
+//  rounds with the merges of each round running concurrently. Not stable.
+template <typename T, typename C>
+void parallelSort(vector<T> &v, long long begin, long long end, C comp, int numThreads = defaultThreads()) {
+    long long len = end - begin;
+    int blocks = (int)max<long long>(1, min<long long>(numThreads, len / 4096));
+    if (blocks == 1) {
+        sort(v.begin() + begin, v.begin() + end, comp);
+        return;
+    }
+    vector<long long> bound(blocks + 1);
+    for (int b=0; b<=blocks; b++) {
+        bound[b] = begin + len * b / blocks;
+    }
+    parallelFor(0, blocks, [&](long long b) {
+        sort(v.begin() + bound[b], v.begin() + bound[b+1], comp);
+    }, numThreads);
+    for (int width=1; width<blocks; width*=2) {
+        parallelFor(0, (blocks + 2*width - 1) / (2*width), [&](long long p) {
+            long long lo = bound[2*width*p];
+            long long mid = bound[min<long long>(2*width*p + width, blocks)];
+            long long hi = bound[min<long long>(2*width*p + 2*width, blocks)];
+            inplace_merge(v.begin() + lo, v.begin() + mid, v.begin() + hi, comp);
+        }, numThreads);
+    }
+}
+
+// Reorders v[begin, end) so that the elements satisfying pred come first, keeping the relative order within
+//  both groups, and returns the index of the first element that does not satisfy it
+// pred is called exactly once per element, concurrently from up to numThreads threads
+template <typename T, typename P>
+long long parallelPartition(vector<T> &v, long long begin, long long end, P pred, int numThreads = defaultThreads()) {
+    long long len = end - begin;
+    if (len <= 0) {
+        return begin;
+    }
+    const long long block = max<long long>(4096, (len + 4LL*numThreads - 1) / (4LL*numThreads));
+    long long blocks = (len + block - 1) / block;
+    vector<char> keep(len);
+    vector<long long> kept(blocks + 1); // Number of kept elements before each block, after the prefix sum
+    parallelFor(0, blocks, [&](long long b) {
+        long long count = 0;
+        for (long long i = b * block; i < min(len, (b+1) * block); i++) {
+            keep[i] = pred(v[begin + i]) ? 1 : 0;
+            count += keep[i];
+        }
+        kept[b+1] = count;
+    }, numThreads);
+    for (long long b=0; b<blocks; b++) {
+        kept[b+1] += kept[b];
+    }
+    vector<T> tmp(len);
+    parallelFor(0, blocks, [&](long long b) {
+        long long front = kept[b];
+        long long back = kept[blocks] + b * block - kept[b]; // Elements not kept before this block come after all kept ones
+        for (long long i = b * block; i < min(len, (b+1) * block); i++) {
+            tmp[keep[i] ? front++ : back++] = move(v[begin + i]);
+        }
+    }, numThreads);
+    parallelForChunks(0, len, [&](long long lo, long long hi, int) {
+        move(tmp.begin() + lo, tmp.begin() + hi, v.begin() + begin + lo);
+    }, numThreads, 1 << 16);
+    return begin + kept[blocks];
+}
+
+#endif
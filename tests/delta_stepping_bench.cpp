@@ -0,0 +1,68 @@
+// Benchmark of deltaStepping against shortestDistance (Dijkstra) on a road-like and a scale-free graph
+// Build and run with: g++ -std=c++17 -O2 -pthread tests/delta_stepping_bench.cpp && ./a.out [numThreads]
+// Prints seconds per run and checks that every run agrees with Dijkstra. delta 0 is the automatic choice.
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <chrono>
+#include "../directed_graph.cpp"
+
+template <typename F>
+double seconds(F f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void bench(const char* name, const CSRGraph &g, const vector<long long> &deltas, int numThreads) {
+    vector<int> ref;
+    printf("%s: n %d, m %lld\n  Dijkstra %.3f\n", name, g.size(), g.numEdges(),
+           seconds([&] { ref = shortestDistance(g, 0); }));
+    for (long long delta : deltas) {
+        vector<long long> dist;
+        double t = seconds([&] { dist = deltaStepping(g, 0, delta, numThreads); });
+        assert(vector<long long>(ref.begin(), ref.end()) == dist);
+        printf("  delta %lld %.3f\n", delta, t);
+    }
+}
+
+int main(int argc, char** argv) {
+    int numThreads = argc > 1 ? atoi(argv[1]) : defaultThreads();
+    mt19937 rng(2);
+
+    // Road-like: a side x side grid with lengths 1 to 1000 in both directions
+    {
+        const int side = 1400;
+        vector<pair<int,pi>> edges;
+        for (int r=0; r<side; r++) {
+            for (int c=0; c<side; c++) {
+                if (c+1 < side) {
+                    edges.push_back({1 + (int)(rng() % 1000), {r*side + c, r*side + c + 1}});
+                }
+                if (r+1 < side) {
+                    edges.push_back({1 + (int)(rng() % 1000), {r*side + c, (r+1)*side + c}});
+                }
+            }
+        }
+        bench("1400x1400 grid", buildCSR(side*side, edges, true), {0, 250, 1000, 4000}, numThreads);
+    }
+
+    // Scale-free: preferential attachment, each new node links to 4 earlier ones in both directions
+    {
+        const int n = 1000000;
+        vector<pair<int,pi>> edges;
+        vector<int> ends; // One entry per edge end, so sampling from it favours high degrees
+        for (int i=1; i<n; i++) {
+            for (int k=0; k<4; k++) {
+                int t = ends.empty() || rng() % 2 ? rng() % i : ends[rng() % ends.size()];
+                edges.push_back({1 + (int)(rng() % 1000), {i, t}});
+                ends.push_back(t);
+                ends.push_back(i);
+            }
+        }
+        bench("preferential attachment", buildCSR(n, edges, true), {0, 50, 250, 1000}, numThreads);
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+// Checks for the parallel algorithms in directed_graph.cpp against their serial counterparts
+// Build and run with: g++ -std=c++17 -O2 -pthread tests/directed_graph_test.cpp && ./a.out
+
+#include <cassert>
+#include <cstdio>
+#include <random>
+#include "../directed_graph.cpp"
+
+// Whether two labellings split the nodes into the same SCCs
+bool sameSCCs(int n, const vector<vector<int>> &scc, const vector<int> &label) {
+    for (const vector<int> &c : scc) {
+        for (int node : c) {
+            if (label[node] != label[c[0]]) {
+                return false;
+            }
+        }
+    }
+    vector<int> owner(n, -1); // SCC index that first used each label
+    for (int i=0; i<(int)scc.size(); i++) {
+        for (int node : scc[i]) {
+            int l = label[node];
+            if (l < 0 || l >= n || (owner[l] != -1 && owner[l] != i)) {
+                return false;
+            }
+            owner[l] = i;
+        }
+    }
+    return true;
+}
+
+// k 2-cycles linked into a chain, each pointing to the previous one if down is set and to the next one otherwise
+// Every coloring round labels a single SCC here, so parallelSCC has to hand over to its serial finish.
+void testSCCChain(int k, bool down, int numThreads) {
+    int n = 2*k;
+    vector<pi> edges;
+    for (int i=0; i<k; i++) {
+        edges.push_back({2*i, 2*i+1});
+        edges.push_back({2*i+1, 2*i});
+        if (i > 0) {
+            edges.push_back(down ? pi(2*i, 2*(i-1)) : pi(2*(i-1), 2*i));
+        }
+    }
+    CSRGraph g = buildCSR(n, edges);
+    vector<vector<int>> scc = getSCC2(g);
+    assert((int)scc.size() == k);
+    assert(sameSCCs(n, scc, parallelSCC(g, numThreads)));
+}
+
+// Random graphs with lengths up to maxLen against Dijkstra. maxLen * n must fit in an int, the distance type of
+//  shortestDistance.
+void testDeltaStepping(int n, int maxLen, long long delta, mt19937 &rng) {
+    vector<pair<int,pi>> edges;
+    for (int i=0; i<3*n; i++) {
+        edges.push_back({(int)(rng() % (maxLen + 1LL)), {(int)(rng() % n), (int)(rng() % n)}});
+    }
+    CSRGraph g = buildCSR(n, edges);
+    int source = rng() % n;
+    vector<int> ref = shortestDistance(g, source);
+    for (int numThreads : {1, 4}) {
+        vector<long long> dist = deltaStepping(g, source, delta, numThreads);
+        for (int i=0; i<n; i++) {
+            assert(dist[i] == ref[i]);
+        }
+    }
+}
+
+int main() {
+    for (int k : {1, 2000, 20000, 200000}) {
+        for (int numThreads : {1, 4}) {
+            testSCCChain(k, true, numThreads);
+            testSCCChain(k, false, numThreads);
+        }
+    }
+    
+    mt19937 rng(1);
+    for (int it=0; it<200; it++) {
+        testDeltaStepping(1 + it % 50, 1000, 3, rng);
+        testDeltaStepping(1 + it % 50, 5, 3, rng);
+        // A bucket ring covering every length would need over 10^8 slots here
+        testDeltaStepping(2, 1000000000, 3, rng);
+        testDeltaStepping(1 + it % 50, INT_MAX / 50, 3, rng);
+    }
+    puts("directed_graph: all tests passed");
+    return 0;
+}
@@ -1,10 +1,19 @@
 // Algorithms related to undirected graphs
 // Graphs are represented with adjacency lists with n nodes as distinct ints from 0 to n-1
+// Every algorithm takes its graph by const reference and accepts either adjacency lists or a CSRGraph
 
 #include <vector>
 #include <stack>
 #include <queue>
 #include <iostream>
+#include <algorithm>
+#include <climits>
+#include <atomic>
+#include <random>
+#include <unordered_map>
+#include "csr_graph.h"
+#include "parallel.h"
+#include "concurrent_union_find.h"
 
 using namespace std;
 
@@ -17,7 +26,8 @@ typedef vector<vector<pi>> weighted_graph; // (node,distance) pairs
 // Abstracted BFS for a single connected component in a graph
 // Prints all nodes reachable from root in BFS order
 
-void BFS (graph l, int root) {
+template <typename G>
+void BFS (const G &l, int root) {
     vector<int> discovered(l.size(),0); // 0 or 1
     queue<int> q;
     q.push(root);
@@ -42,7 +52,8 @@ void BFS (graph l, int root) {
 // Abstracted iterative DFS for a single connected component in a graph
 // Prints all reachable nodes in DFS order starting with root
 
-void DFS (graph l, int root) {
+template <typename G>
+void DFS (const G &l, int root) {
     vector<int> explored(l.size(),0); // 0 or 1
     stack<int> s;
     s.push(root);
@@ -70,7 +81,8 @@ void DFS (graph l, int root) {
 
 // Given an undirected graph represented by adjacency lists, returns whether or not it is bipartite
 
-bool isBipartite(graph g) {
+template <typename G>
+bool isBipartite(const G &g) {
     queue<int> q;
     vector<int> group(g.size()); // Each node is assigned 1 or -1
     vector<int> discovered(g.size());
@@ -116,7 +128,8 @@ bool isBipartite(graph g) {
 
 // Finds the set of all connected components in an undirected graph using BFS
 
-vector<vector<int>> connectedComp (graph l) {
+template <typename G>
+vector<vector<int>> connectedComp (const G &l) {
     vector<vector<int>> ans;
     vector<int> cur;
     vector<int> discovered(l.size(),0); // 0 or 1
@@ -155,7 +168,8 @@ vector<vector<int>> connectedComp (graph l) {
 
 // Returns all articulation points in a graph
 
-vector<int> getAP (graph g) {
+template <typename G>
+vector<int> getAP (const G &g) {
     vector<int> ap(g.size()); // Records whether or not a node is an AP
     vector<int> ans; // Records all APs
     vector<int> exp(g.size()); // DFS exploring order, starts with 1
@@ -168,12 +182,14 @@ vector<int> getAP (graph g) {
     stack<int> s;
     int order = 0;
     int cur;
+    int rootChildren; // Number of DFS-tree children of the current root
     
     for (int i=0; i<g.size(); i++) {
         if (cleared[i]) {
             continue;
         }
         
+        rootChildren = 0;
         s.push(i);
         while (!s.empty()) {
             cur = s.top();
@@ -186,6 +202,10 @@ vector<int> getAP (graph g) {
                 order++;
                 exp[cur] = order;
                 low[cur] = order;
+                // The copy of cur pushed last is popped first, so parent[cur] is its actual DFS-tree parent
+                if (parent[cur] == i) {
+                    rootChildren++;
+                }
                 for (int node : g[cur]) {
                     if (exp[node] == 0) {
                         s.push(node);
@@ -211,7 +231,7 @@ vector<int> getAP (graph g) {
                     }
                 } else {
                 // If cur is the root, cur is an AP iff cur has more than one disjoint subtrees
-                    ap[cur] = count(parent.begin(),parent.end(),cur)>1 ? 1 : 0;
+                    ap[cur] = rootChildren>1 ? 1 : 0;
                 }
                 cleared[cur] = 1;
                 s.pop();
@@ -235,7 +255,8 @@ vector<int> getAP (graph g) {
 
 // Returns a vector of pairs where each pair contains the endpoints of a bridge
 
-vector<pair<int,int>> getBridges (graph g) {
+template <typename G>
+vector<pair<int,int>> getBridges (const G &g) {
     vector<pair<int,int>> bridges;
     vector<int> exp(g.size());
     vector<int> low(g.size());
@@ -295,41 +316,203 @@ vector<pair<int,int>> getBridges (graph g) {
 
 // 7. PRIM'S MINIMUM SPANNING TREE ALGORITHM ----------------------------------------------------------------
 
-// Returns a vector of pairs, each indicating an edge in the MST
-// Optimal for dense graphs
-// Runs in O(mlogn) time
+// Each variant returns a vector of pairs, each indicating an edge in the MST of the component containing node 0,
+//  or nothing for an empty graph
+// getMST picks the variant by density. getMSTMatrix takes a distance matrix for complete graphs.
+// Keys are 64-bit with LLONG_MAX marking "no edge yet", so edges of length INT_MAX are still taken.
+
+// Index of the smallest key, or -1 if every key is LLONG_MAX
+// The first pass is a branch-free min-reduction over a contiguous array, which compilers turn into SIMD code
+int minKeyIndex(const long long* key, int n) {
+    long long best = LLONG_MAX;
+    for (int i=0; i<n; i++) {
+        best = min(best, key[i]);
+    }
+    if (best == LLONG_MAX) {
+        return -1;
+    }
+    for (int i=0; i<n; i++) {
+        if (key[i] == best) {
+            return i;
+        }
+    }
+    return -1;
+}
 
-vector<pi> getMST(weighted_graph g) {
+// Array-scan Prim: each step scans the key array for the closest unexplored node
+// Nodes already in the tree, and nodes not yet reached, hold LLONG_MAX
+// Optimal for dense graphs. Runs in O(n^2 + m) time
+template <typename G>
+vector<pi> getMSTDense(const G &g) {
+    int n = (int)g.size();
     vector<pi> MST;
-    vector<int> explored(g.size());
-    vector<int> minLen(g.size(), -1); // Length of shortest edge from an explored node to the current node
-    // Each pair denotes an edge. Pair structure: (len, (start, end))
-    priority_queue<pair<int,pi>, vector<pair<int,pi>>, greater<pair<int,pi>>> pq;
-    pq.push(make_pair(0, make_pair(0, 0)));
-    pi curEdge;
-    
-    // In each iteration, add a node not yet explored with the minimum minLen to the set and add the shortest
-    //  edge connecting it from an explored node to the MST
-    while (!pq.empty()) {
-        curEdge = pq.top().second;
-        pq.pop();
-        if (explored[curEdge.second]) {
-            continue;
+    if (n == 0) {
+        return MST;
+    }
+    vector<long long> key(n, LLONG_MAX); // Length of shortest edge from an explored node to each node
+    vector<int> from(n, -1); // Explored end of that edge
+    vector<int> explored(n);
+    int cur = 0;
+    while (cur != -1) {
+        explored[cur] = 1;
+        key[cur] = LLONG_MAX;
+        if (from[cur] != -1) {
+            MST.push_back(make_pair(from[cur], cur));
         }
-        for (pi p : g[curEdge.second]) {
-            if (minLen[p.first] == -1 || p.second < minLen[p.first]) {
-                minLen[p.first] = p.second;
-                pq.push(make_pair(p.second, make_pair(curEdge.second, p.first)));
+        for (pi p : g[cur]) {
+            if (!explored[p.first] && p.second < key[p.first]) {
+                key[p.first] = p.second;
+                from[p.first] = cur;
+            }
+        }
+        cur = minKeyIndex(key.data(), n);
+    }
+    return MST;
+}
+
+// Array-scan Prim on a complete graph given as an n*n distance matrix, which avoids storing n^2 adjacency pairs
+// Runs in O(n^2) time
+vector<pi> getMSTMatrix(const vector<vector<int>> &dist) {
+    int n = (int)dist.size();
+    vector<pi> MST;
+    if (n == 0) {
+        return MST;
+    }
+    vector<long long> key(n, LLONG_MAX);
+    vector<int> from(n, -1);
+    vector<char> explored(n);
+    int cur = 0;
+    while (cur != -1) {
+        explored[cur] = 1;
+        key[cur] = LLONG_MAX;
+        if (from[cur] != -1) {
+            MST.push_back(make_pair(from[cur], cur));
+        }
+        // Relaxation and min-reduction share one branch-free pass over contiguous arrays
+        const int* row = dist[cur].data();
+        long long best = LLONG_MAX;
+        for (int i=0; i<n; i++) {
+            bool closer = !explored[i] & (row[i] < key[i]);
+            key[i] = closer ? row[i] : key[i];
+            from[i] = closer ? cur : from[i];
+            best = min(best, key[i]);
+        }
+        cur = -1;
+        for (int i=0; best != LLONG_MAX; i++) {
+            if (key[i] == best) {
+                cur = i;
+                break;
+            }
+        }
+    }
+    return MST;
+}
+
+// Binary min-heap of nodes keyed by key[node], with pos[node] tracking each node's slot so that keys can be
+//  decreased in place. Unlike a lazy priority queue, it never holds more than n entries.
+struct IndexedHeap {
+    vector<int> heap;
+    vector<int> pos; // -1 if not in the heap
+    vector<long long> key;
+};
+
+void heapSwap(IndexedHeap &h, int i, int j) {
+    swap(h.heap[i], h.heap[j]);
+    h.pos[h.heap[i]] = i;
+    h.pos[h.heap[j]] = j;
+}
+
+void heapUp(IndexedHeap &h, int i) {
+    while (i > 0 && h.key[h.heap[(i-1)/2]] > h.key[h.heap[i]]) {
+        heapSwap(h, i, (i-1)/2);
+        i = (i-1)/2;
+    }
+}
+
+void heapDown(IndexedHeap &h, int i) {
+    int n = (int)h.heap.size();
+    int j;
+    while ((j = 2*i+1) < n) {
+        if (j+1 < n && h.key[h.heap[j+1]] < h.key[h.heap[j]]) {
+            j++;
+        }
+        if (h.key[h.heap[i]] <= h.key[h.heap[j]]) {
+            break;
+        }
+        heapSwap(h, i, j);
+        i = j;
+    }
+}
+
+// Inserts node with key k, or lowers its key to k if it is already in the heap
+void heapPushOrDecrease(IndexedHeap &h, int node, long long k) {
+    h.key[node] = k;
+    if (h.pos[node] == -1) {
+        h.pos[node] = (int)h.heap.size();
+        h.heap.push_back(node);
+    }
+    heapUp(h, h.pos[node]);
+}
+
+int heapPop(IndexedHeap &h) {
+    int top = h.heap[0];
+    heapSwap(h, 0, (int)h.heap.size()-1);
+    h.heap.pop_back();
+    h.pos[top] = -1;
+    if (!h.heap.empty()) {
+        heapDown(h, 0);
+    }
+    return top;
+}
+
+// Indexed-heap Prim with decrease-key
+// Optimal for sparse graphs. Runs in O(mlogn) time with O(n) heap space.
+template <typename G>
+vector<pi> getMSTHeap(const G &g) {
+    int n = (int)g.size();
+    vector<pi> MST;
+    if (n == 0) {
+        return MST;
+    }
+    vector<int> from(n, -1);
+    vector<int> explored(n);
+    IndexedHeap h {{}, vector<int>(n, -1), vector<long long>(n, LLONG_MAX)};
+    heapPushOrDecrease(h, 0, 0);
+    int cur;
+    while (!h.heap.empty()) {
+        cur = heapPop(h);
+        explored[cur] = 1;
+        if (from[cur] != -1) {
+            MST.push_back(make_pair(from[cur], cur));
+        }
+        for (pi p : g[cur]) {
+            if (!explored[p.first] && p.second < h.key[p.first]) {
+                from[p.first] = cur;
+                heapPushOrDecrease(h, p.first, p.second);
             }
         }
-        explored[curEdge.second] = 1;
-        MST.push_back(curEdge);
     }
-    
-    MST.erase(MST.begin()); // The self-edge (0,0) will always be first in the resulting vector. Exclude it.
     return MST;
 }
 
+// Uses the array scan when n^2 < m*log2(n), and the indexed heap otherwise
+template <typename G>
+vector<pi> getMST(const G &g) {
+    long long n = (long long)g.size();
+    if (n == 0) {
+        return {};
+    }
+    long long m = 0;
+    for (int i=0; i<n; i++) {
+        m += g[i].size();
+    }
+    long long logn = 1;
+    while ((1LL << logn) < n) {
+        logn++;
+    }
+    return n * n < m * logn ? getMSTDense(g) : getMSTHeap(g);
+}
+
 // ----------------------------------------------------------------------------------------------------------
 
 
@@ -352,3 +535,624 @@ vector<pi> getMST(weighted_graph g) {
 // Refer to the union-find template for implementation
 
 // ----------------------------------------------------------------------------------------------------------
+
+
+// 10. DIRECTION-OPTIMIZING PARALLEL BFS ----------------------------------------------------------------------
+
+// Level-synchronous parallel BFS from root on an undirected CSR graph (Beamer et al.)
+// Small frontiers are expanded top-down: threads scan the frontier's edges and claim undiscovered neighbours
+//  with compare-and-swap on their parent. Once the frontier's edges outnumber a fraction of the unexplored
+//  edges, it switches to bottom-up sweeps in which every undiscovered node looks for a parent in the frontier
+//  bitmap and stops at the first hit. It switches back once the frontier shrinks.
+// Returns the distance and BFS-tree parent of every node, -1 if unreachable. The root is its own parent.
+// Runs in O(n+m) work
+
+struct BFSTree {
+    vector<int> dist;
+    vector<int> parent;
+};
+
+BFSTree parallelBFS(const CSRGraph &g, int root, int numThreads = defaultThreads()) {
+    const int alpha = 15; // Go bottom-up once frontier edges exceed unexplored edges / alpha
+    const int beta = 18; // Go top-down again once the frontier holds fewer than n / beta nodes
+    int n = g.size();
+    numThreads = max(1, numThreads);
+    BFSTree tree {vector<int>(n, -1), vector<int>(n)};
+    vector<atomic<int>> parent(n);
+    for (int i=0; i<n; i++) {
+        parent[i].store(-1, memory_order_relaxed);
+    }
+    parent[root] = root;
+    tree.dist[root] = 0;
+    
+    vector<int> frontier {root};
+    vector<vector<int>> localNext(numThreads); // Per-thread discoveries of the current top-down step
+    vector<long long> localScout(numThreads); // Per-thread sum of degrees of those discoveries
+    vector<char> front(n), next(n); // Frontier bitmaps for bottom-up steps
+    long long unexplored = g.numEdges() - g.degree(root); // Edges not yet incident to the explored set
+    long long scout = g.degree(root); // Edges leaving the current frontier
+    long long frontierSize = 1;
+    int level = 0;
+    
+    while (frontierSize > 0) {
+        if (scout > unexplored / alpha) {
+            // Bottom-up steps
+            fill(front.begin(), front.end(), 0);
+            for (int node : frontier) {
+                front[node] = 1;
+            }
+            long long prevSize;
+            do {
+                prevSize = frontierSize;
+                atomic<long long> awake(0), awakeEdges(0);
+                parallelForChunks(0, n, [&](long long lo, long long hi, int) {
+                    long long count = 0, edges = 0;
+                    for (long long v=lo; v<hi; v++) {
+                        next[v] = 0;
+                        if (parent[v].load(memory_order_relaxed) != -1) {
+                            continue;
+                        }
+                        // Only the thread owning v writes to it, so no synchronization is needed here
+                        for (int u : g[v]) {
+                            if (front[u]) {
+                                parent[v].store(u, memory_order_relaxed);
+                                tree.dist[v] = level + 1;
+                                next[v] = 1;
+                                count++;
+                                edges += g.degree((int)v);
+                                break;
+                            }
+                        }
+                    }
+                    awake += count;
+                    awakeEdges += edges;
+                }, numThreads);
+                front.swap(next);
+                frontierSize = awake;
+                unexplored -= awakeEdges; // The new frontier's edges are now incident to the explored set
+                level++;
+            } while (frontierSize >= prevSize || frontierSize > n / beta);
+            
+            // Convert the bitmap back into a queue for top-down steps
+            frontier.clear();
+            scout = 0;
+            for (int i=0; i<n; i++) {
+                if (front[i]) {
+                    frontier.push_back(i);
+                    scout += g.degree(i);
+                }
+            }
+        } else {
+            // Top-down step
+            for (int t=0; t<numThreads; t++) {
+                localNext[t].clear();
+                localScout[t] = 0;
+            }
+            parallelForChunks(0, (long long)frontier.size(), [&](long long lo, long long hi, int t) {
+                for (long long i=lo; i<hi; i++) {
+                    int u = frontier[i];
+                    for (int v : g[u]) {
+                        int expected = -1;
+                        if (parent[v].load(memory_order_relaxed) == -1 &&
+                            parent[v].compare_exchange_strong(expected, u, memory_order_relaxed)) {
+                            tree.dist[v] = level + 1;
+                            localNext[t].push_back(v);
+                            localScout[t] += g.degree(v);
+                        }
+                    }
+                }
+            }, numThreads, 64);
+            frontier.clear();
+            scout = 0;
+            for (int t=0; t<numThreads; t++) {
+                frontier.insert(frontier.end(), localNext[t].begin(), localNext[t].end());
+                scout += localScout[t];
+            }
+            unexplored -= scout;
+            level++;
+        }
+        frontierSize = (long long)frontier.size();
+    }
+    
+    for (int i=0; i<n; i++) {
+        tree.parent[i] = parent[i].load(memory_order_relaxed);
+    }
+    return tree;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+
+// 11. PARALLEL CONNECTED COMPONENTS ------------------------------------------------------------------------
+
+// Afforest (Sutton et al.) on an undirected CSR graph
+// Every node is first linked to its first few neighbours in the concurrent union-find of
+//  concurrent_union_find.h, and the resulting trees are flattened. A random sample then identifies the
+//  component that is most likely the giant one, and only nodes outside it process their remaining edges. Since
+//  every edge is stored in both directions, an edge between the giant component and another node is still seen
+//  from the other side.
+// Returns the component label of every node, which is the smallest node in its component
+// Runs in O(n+m) work in practice, and far less when one component dominates
+
+vector<int> parallelCC(const CSRGraph &g, int numThreads = defaultThreads()) {
+    const int neighbourRounds = 2;
+    const int numSamples = 1024;
+    int n = g.size();
+    numThreads = max(1, numThreads);
+    ConcurrentUnionFind uf = makeConcurrentUF(n);
+    
+    // Link each node to its first neighbourRounds neighbours, flattening after each round
+    for (int r=0; r<neighbourRounds; r++) {
+        parallelFor(0, n, [&](long long v) {
+            if (r < g.degree(v)) {
+                Union(uf, (int)v, g[v][r]);
+            }
+        }, numThreads, 4096);
+        flattenUF(uf, numThreads);
+    }
+    
+    // Sample the most frequent label
+    int giant = 0;
+    if (n > 0) {
+        unordered_map<int,int> freq;
+        mt19937 rng(27491095);
+        int best = 0;
+        for (int i=0; i<numSamples; i++) {
+            int label = (int)uf.parent[rng() % n].load(memory_order_relaxed);
+            if (++freq[label] > best) {
+                best = freq[label];
+                giant = label;
+            }
+        }
+    }
+    
+    // Finish the remaining edges of every node outside the giant component
+    parallelFor(0, n, [&](long long v) {
+        if ((int)uf.parent[v].load(memory_order_relaxed) == giant) {
+            return;
+        }
+        for (int r=neighbourRounds; r<g.degree(v); r++) {
+            Union(uf, (int)v, g[v][r]);
+        }
+    }, numThreads, 1024);
+    flattenUF(uf, numThreads);
+    
+    vector<int> labels(n);
+    for (int i=0; i<n; i++) {
+        labels[i] = (int)uf.parent[i].load(memory_order_relaxed);
+    }
+    return labels;
+}
+
+// Optional grouping step: turns a label array into lists of nodes, one per component, in O(n) time
+// Components are ordered by label and nodes within a component in ascending order, as in connectedComp
+vector<vector<int>> groupComponents(const vector<int> &labels) {
+    vector<int> index(labels.size(), -1); // Position of each label's group in ans
+    vector<vector<int>> ans;
+    for (int i=0; i<(int)labels.size(); i++) {
+        if (index[labels[i]] == -1) {
+            index[labels[i]] = (int)ans.size();
+            ans.push_back({});
+        }
+        ans[index[labels[i]]].push_back(i);
+    }
+    return ans;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+
+// 12. BICONNECTED COMPONENTS AND BLOCK-CUT TREE ------------------------------------------------------------
+
+// A single iterative DFS (Hopcroft-Tarjan) that finds articulation points, bridges and the biconnected
+//  components (blocks) at once, so callers needing several of them pay for one traversal
+// Each DFS frame keeps its position in the node's neighbour list, and tree and back edges are pushed on an edge
+//  stack. When a child's subtree cannot reach above its parent, the edges on top of the stack down to that
+//  tree edge form one block.
+// Runs in O(n+m) time
+
+// All outputs are flat arrays
+struct BlockCutTree {
+    vector<int> ap; // Articulation points in ascending order
+    vector<pi> bridges; // (parent, child) in the DFS tree
+    int numBlocks;
+    vector<int> blockStart; // The edges of block b are blockEdges[blockStart[b]] to blockEdges[blockStart[b+1]-1]
+    vector<pi> blockEdges;
+    // Block-cut tree: node b < numBlocks is a block and node numBlocks+i is ap[i]
+    // Each pair links a block to an articulation point it contains
+    vector<pi> treeEdges;
+};
+
+template <typename G>
+BlockCutTree getBiconnected(const G &g) {
+    int n = (int)g.size();
+    BlockCutTree bct;
+    bct.numBlocks = 0;
+    bct.blockStart.push_back(0);
+    vector<int> exp(n); // DFS exploring order, starts with 1
+    vector<int> low(n); // Same meaning as in getAP
+    vector<int> parent(n, -1);
+    vector<int> next(n); // Position of the next neighbour to examine
+    vector<int> skippedParent(n); // The edge back to the parent is skipped once, so parallel edges still count
+    vector<int> isAP(n);
+    stack<int> s;
+    vector<pi> edges; // Edge stack
+    int order = 0;
+    int cur, node, rootChildren;
+    
+    for (int i=0; i<n; i++) {
+        if (exp[i]) {
+            continue;
+        }
+        exp[i] = low[i] = ++order;
+        rootChildren = 0;
+        s.push(i);
+        while (!s.empty()) {
+            cur = s.top();
+            if (next[cur] < (int)g[cur].size()) {
+                node = g[cur][next[cur]++];
+                if (node == parent[cur] && !skippedParent[cur]) {
+                    skippedParent[cur] = 1;
+                } else if (exp[node] == 0) {
+                    // Tree edge
+                    parent[node] = cur;
+                    exp[node] = low[node] = ++order;
+                    edges.push_back(make_pair(cur, node));
+                    s.push(node);
+                    if (cur == i) {
+                        rootChildren++;
+                    }
+                } else if (exp[node] < exp[cur]) {
+                    // Back edge to an ancestor. Edges to descendants were already seen from the other end.
+                    low[cur] = min(low[cur], exp[node]);
+                    edges.push_back(make_pair(cur, node));
+                }
+                continue;
+            }
+            
+            // All neighbours examined: the recursive call on cur returns
+            s.pop();
+            int p = parent[cur];
+            if (p == -1) {
+                continue;
+            }
+            low[p] = min(low[p], low[cur]);
+            if (low[cur] >= exp[p]) {
+                // Nothing in cur's subtree reaches above p, so p separates it and a block ends here
+                if (parent[p] != -1) {
+                    isAP[p] = 1;
+                }
+                if (low[cur] > exp[p]) {
+                    bct.bridges.push_back(make_pair(p, cur));
+                }
+                pi e;
+                do {
+                    e = edges.back();
+                    edges.pop_back();
+                    bct.blockEdges.push_back(e);
+                } while (e != make_pair(p, cur));
+                bct.blockStart.push_back((int)bct.blockEdges.size());
+                bct.numBlocks++;
+            }
+        }
+        if (rootChildren > 1) {
+            isAP[i] = 1;
+        }
+    }
+    
+    vector<int> apIndex(n, -1);
+    for (int i=0; i<n; i++) {
+        if (isAP[i]) {
+            apIndex[i] = (int)bct.ap.size();
+            bct.ap.push_back(i);
+        }
+    }
+    // Link each block to the distinct articulation points among its endpoints
+    vector<int> lastBlock(n, -1);
+    for (int b=0; b<bct.numBlocks; b++) {
+        for (int j=bct.blockStart[b]; j<bct.blockStart[b+1]; j++) {
+            for (int v : {bct.blockEdges[j].first, bct.blockEdges[j].second}) {
+                if (isAP[v] && lastBlock[v] != b) {
+                    lastBlock[v] = b;
+                    bct.treeEdges.push_back(make_pair(b, bct.numBlocks + apIndex[v]));
+                }
+            }
+        }
+    }
+    return bct;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+
+// 13. PARALLEL BIPARTITENESS TESTING AND 2-COLORING --------------------------------------------------------
+
+// Colors each connected component of an undirected CSR graph by BFS level parity, expanding every frontier in
+//  parallel. Neighbours are claimed with compare-and-swap on their level. An edge between two nodes on the same
+//  level closes an odd cycle, so conflicts are caught during the traversal and all threads stop at once.
+// Returns a valid 0/1 coloring, or a witness odd cycle listed as consecutive nodes (the last node is adjacent
+//  to the first)
+// Runs in O(n+m) work, and stops at the first level containing a conflict
+
+struct BipartiteResult {
+    bool bipartite;
+    vector<int> color; // Empty if not bipartite
+    vector<int> oddCycle; // Empty if bipartite
+};
+
+BipartiteResult parallelBipartite(const CSRGraph &g, int numThreads = defaultThreads()) {
+    int n = g.size();
+    numThreads = max(1, numThreads);
+    BipartiteResult res {true, {}, {}};
+    vector<atomic<int>> level(n); // BFS level within the node's component, -1 if undiscovered
+    for (int i=0; i<n; i++) {
+        level[i].store(-1, memory_order_relaxed);
+    }
+    vector<int> parent(n, -1); // Written only by the thread that claims a node
+    vector<int> frontier;
+    vector<vector<int>> localNext(numThreads);
+    atomic<bool> conflict(false);
+    atomic<long long> conflictEdge(-1); // Encoded as u*n+v
+    
+    for (int i=0; i<n && !conflict; i++) {
+        if (level[i] != -1) {
+            continue;
+        }
+        level[i] = 0;
+        frontier.assign(1, i);
+        for (int lv=0; !frontier.empty() && !conflict; lv++) {
+            for (int t=0; t<numThreads; t++) {
+                localNext[t].clear();
+            }
+            parallelForChunks(0, (long long)frontier.size(), [&](long long lo, long long hi, int t) {
+                for (long long j=lo; j<hi && !conflict.load(memory_order_relaxed); j++) {
+                    int u = frontier[j];
+                    for (int v : g[u]) {
+                        int expected = -1;
+                        if (level[v].compare_exchange_strong(expected, lv + 1, memory_order_relaxed)) {
+                            parent[v] = u;
+                            localNext[t].push_back(v);
+                        } else if (expected == lv) {
+                            // Neighbours can only be one level apart in a bipartite graph
+                            long long none = -1;
+                            conflictEdge.compare_exchange_strong(none, (long long)u * n + v);
+                            conflict = true;
+                            break;
+                        }
+                    }
+                }
+            }, numThreads, 64);
+            frontier.clear();
+            for (int t=0; t<numThreads; t++) {
+                frontier.insert(frontier.end(), localNext[t].begin(), localNext[t].end());
+            }
+        }
+    }
+    
+    if (!conflict) {
+        res.color.resize(n);
+        for (int i=0; i<n; i++) {
+            res.color[i] = level[i] & 1;
+        }
+        return res;
+    }
+    
+    // Both ends of the conflicting edge are on the same level, so walking their BFS-tree paths up in lockstep
+    //  meets at their lowest common ancestor. The two paths and the edge form an odd cycle.
+    res.bipartite = false;
+    int u = (int)(conflictEdge / n);
+    int v = (int)(conflictEdge % n);
+    vector<int> down; // From v up to, but excluding, the common ancestor
+    while (u != v) {
+        res.oddCycle.push_back(u);
+        down.push_back(v);
+        u = parent[u];
+        v = parent[v];
+    }
+    res.oddCycle.push_back(u);
+    res.oddCycle.insert(res.oddCycle.end(), down.rbegin(), down.rend());
+    return res;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+
+// 14. PARALLEL BORUVKA MINIMUM SPANNING FOREST -------------------------------------------------------------
+
+// Boruvka rounds on a weighted undirected CSR graph. In each round, every component finds its lightest outgoing
+//  edge in parallel with an atomic min over (length, edge id) keys. The chosen edges are added to the forest and
+//  contracted with the concurrent union-find of concurrent_union_find.h, and edges that now lie inside a
+//  component are filtered out of the edge list.
+// Edge ids break ties between equal lengths, so the chosen edges never form a cycle and two components never
+//  pick different edges to each other. Disconnected graphs yield a minimum spanning forest.
+// Returns a vector of pairs, each indicating an edge in the forest
+// Runs in O(mlogn) work over O(logn) rounds
+
+vector<pi> parallelBoruvka(const CSRGraph &g, int numThreads = defaultThreads()) {
+    int n = g.size();
+    numThreads = max(1, numThreads);
+    
+    // List every undirected edge once, from its smaller end. first[u] becomes the slot of u's first edge.
+    vector<long long> first(n + 1);
+    parallelFor(0, n, [&](long long u) {
+        for (int v : g[u]) {
+            first[u+1] += u < v;
+        }
+    }, numThreads, 1024);
+    for (int i=0; i<n; i++) {
+        first[i+1] += first[i];
+    }
+    long long m = first[n];
+    vector<int> eu(m), ev(m), ew(m);
+    parallelFor(0, n, [&](long long u) {
+        long long slot = first[u];
+        for (pi p : g[u]) {
+            if (u < p.first) {
+                eu[slot] = u;
+                ev[slot] = p.first;
+                ew[slot] = p.second;
+                slot++;
+            }
+        }
+    }, numThreads, 1024);
+    
+    vector<unsigned> active(m); // Ids of edges whose ends are still in different components
+    for (long long i=0; i<m; i++) {
+        active[i] = (unsigned)i;
+    }
+    ConcurrentUnionFind uf = makeConcurrentUF(n); // Flattened after every round, so parent[i] is i's root
+    vector<atomic<unsigned long long>> lightest(n); // Smallest key leaving each component root
+    vector<atomic<char>> chosen(m);
+    for (long long i=0; i<m; i++) {
+        chosen[i].store(0, memory_order_relaxed);
+    }
+    vector<vector<pi>> localForest(numThreads);
+    vector<vector<unsigned>> localActive(numThreads);
+    const unsigned long long NONE = ~0ULL;
+    
+    while (!active.empty()) {
+        parallelFor(0, n, [&](long long v) {
+            lightest[v].store(NONE, memory_order_relaxed);
+        }, numThreads, 4096);
+        
+        // Lightest outgoing edge of every component. Lengths are shifted to be non-negative so keys compare as
+        //  unsigned values.
+        parallelFor(0, (long long)active.size(), [&](long long i) {
+            unsigned e = active[i];
+            unsigned long long key = ((unsigned long long)((long long)ew[e] + 2147483648LL) << 32) | e;
+            uint32_t ends[2] = {uf.parent[eu[e]].load(memory_order_relaxed),
+                                uf.parent[ev[e]].load(memory_order_relaxed)};
+            for (uint32_t c : ends) {
+                unsigned long long cur = lightest[c].load(memory_order_relaxed);
+                while (key < cur && !lightest[c].compare_exchange_weak(cur, key, memory_order_relaxed)) {}
+            }
+        }, numThreads, 4096);
+        
+        // Add each chosen edge once and contract
+        parallelForChunks(0, n, [&](long long lo, long long hi, int t) {
+            for (long long r=lo; r<hi; r++) {
+                unsigned long long key = lightest[r].load(memory_order_relaxed);
+                if (key == NONE) {
+                    continue;
+                }
+                unsigned e = (unsigned)(key & 0xffffffffULL);
+                if (chosen[e].exchange(1) == 0) {
+                    localForest[t].push_back(make_pair(eu[e], ev[e]));
+                    Union(uf, eu[e], ev[e]);
+                }
+            }
+        }, numThreads, 4096);
+        flattenUF(uf, numThreads);
+        
+        // Keep only edges between different components
+        parallelForChunks(0, (long long)active.size(), [&](long long lo, long long hi, int t) {
+            for (long long i=lo; i<hi; i++) {
+                unsigned e = active[i];
+                if (uf.parent[eu[e]].load(memory_order_relaxed) != uf.parent[ev[e]].load(memory_order_relaxed)) {
+                    localActive[t].push_back(e);
+                }
+            }
+        }, numThreads, 4096);
+        active.clear();
+        for (int t=0; t<numThreads; t++) {
+            active.insert(active.end(), localActive[t].begin(), localActive[t].end());
+            localActive[t].clear();
+        }
+    }
+    
+    vector<pi> forest;
+    for (int t=0; t<numThreads; t++) {
+        forest.insert(forest.end(), localForest[t].begin(), localForest[t].end());
+    }
+    return forest;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+
+// 15. VISITOR-BASED BFS AND DFS ----------------------------------------------------------------------------
+
+// Traversals that call a visitor instead of printing, for callers running many small traversals
+// The visitor is a template parameter, so its callbacks are resolved at compile time and inlined. A workspace
+//  keeps the visited marks and the queue or stack between calls, and each traversal bumps a generation number
+//  instead of clearing the marks, so repeated traversals allocate nothing and start in O(1).
+// Each traversal runs in O(size of the reached part) time
+
+// Visitors derive from this and override only the callbacks they need
+// The visitor is taken by forwarding reference, so both a named visitor, whose state the caller reads afterwards,
+//  and a temporary can be passed
+struct DefaultVisitor {
+    void discover(int /* node */) {} // First time node is reached
+    void examineEdge(int /* from */, int /* to */) {} // Every edge leaving a reached node
+    void finish(int /* node */) {} // All edges of node examined (and, for DFS, all its descendants finished)
+};
+
+struct TraversalWorkspace {
+    vector<unsigned> mark; // mark[i] == generation iff i was reached by the current traversal
+    unsigned generation = 0;
+    vector<int> queue;
+    vector<pi> stack; // DFS frames: (node, position of the next neighbour to examine)
+};
+
+// Starts a new traversal over a graph of n nodes
+void beginTraversal(TraversalWorkspace &ws, int n) {
+    if (ws.mark.size() < (size_t)n) {
+        ws.mark.resize(n, 0);
+    }
+    if (++ws.generation == 0) {
+        // Marks from 2^32 traversals ago would look current again
+        fill(ws.mark.begin(), ws.mark.end(), 0);
+        ws.generation = 1;
+    }
+    ws.queue.clear();
+    ws.stack.clear();
+}
+
+template <typename G, typename V>
+void visitBFS(const G &g, int root, V &&visitor, TraversalWorkspace &ws) {
+    beginTraversal(ws, (int)g.size());
+    unsigned gen = ws.generation;
+    ws.mark[root] = gen;
+    visitor.discover(root);
+    ws.queue.push_back(root);
+    // The queue is never popped, so it also records the BFS order
+    for (size_t head=0; head<ws.queue.size(); head++) {
+        int cur = ws.queue[head];
+        for (int node : g[cur]) {
+            visitor.examineEdge(cur, node);
+            if (ws.mark[node] != gen) {
+                ws.mark[node] = gen;
+                visitor.discover(node);
+                ws.queue.push_back(node);
+            }
+        }
+        visitor.finish(cur);
+    }
+}
+
+template <typename G, typename V>
+void visitDFS(const G &g, int root, V &&visitor, TraversalWorkspace &ws) {
+    beginTraversal(ws, (int)g.size());
+    unsigned gen = ws.generation;
+    ws.mark[root] = gen;
+    visitor.discover(root);
+    ws.stack.push_back(make_pair(root, 0));
+    while (!ws.stack.empty()) {
+        pi &top = ws.stack.back();
+        int cur = top.first;
+        if (top.second == (int)g[cur].size()) {
+            ws.stack.pop_back();
+            visitor.finish(cur);
+            continue;
+        }
+        int node = g[cur][top.second++];
+        visitor.examineEdge(cur, node);
+        if (ws.mark[node] != gen) {
+            ws.mark[node] = gen;
+            visitor.discover(node);
+            ws.stack.push_back(make_pair(node, 0)); // May invalidate top, which is not used again
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------------------------------------
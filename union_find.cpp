@@ -4,6 +4,13 @@
 #include <vector>
 #include <stack>
 #include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <map>
+#include "parallel.h"
+#include "concurrent_union_find.h"
 
 using namespace std;
 
@@ -12,66 +19,65 @@ typedef vector<vector<int>> tree;
 
 // UNION FIND -----------------------------------------------------------------------------------------------
 
-struct UFNode {
-    int val;
-    UFNode* next;
-};
-
 // Requires input to be distinct ints from 0 to n-1; otherwise vectors need to be replaced with maps
+// Each group is a tree stored in a flat parent array, with the root as the group's representative
 struct UnionFind {
-    vector<UFNode*> nodes;
-    vector<int> groupSize;
+    vector<uint32_t> parent; // parent[i] == i iff i is a root
+    vector<int> groupSize; // Only meaningful for roots
 };
 
 // Returns a union-find given a vector of distinct ints from 0 to n-1
 // This function has to be adapted should input form changes
 UnionFind makeUF(int n) {
-    UnionFind uf {.nodes = vector<UFNode*>(n), .groupSize = vector<int>(n, 1)};
+    UnionFind uf {vector<uint32_t>(n), vector<int>(n, 1)};
     for (int i=0; i<n; i++) {
-        uf.nodes[i] = new UFNode {i, nullptr};
+        uf.parent[i] = i;
     }
     return uf;
 }
 
-// Given a valid item, finds the group it belongs to while performing path compression along the way
+// Given a valid item, finds the group it belongs to while performing path halving along the way: every other
+//  node on the path is pointed at its grandparent, in place and in one pass
 // O(logn) worst case, O(1) average
 int Find(UnionFind &uf, int a) {
-    vector<UFNode*> v;
-    UFNode *cur = uf.nodes[a];
-    while (cur->next) {
-        v.push_back(cur);
-        cur = cur->next;
-    }
-    for (UFNode *node : v) {
-        node->next = cur;
+    uint32_t cur = a;
+    while (uf.parent[cur] != cur) {
+        uf.parent[cur] = uf.parent[uf.parent[cur]];
+        cur = uf.parent[cur];
     }
-    return cur->val;
+    return (int)cur;
 }
 
 // Given two valid items, merge the groups they belong to
 // O(logn) worst case, O(1) average
 void Union(UnionFind &uf, int a, int b) {
-    UFNode *first = uf.nodes[Find(uf, a)];
-    UFNode *second = uf.nodes[Find(uf, b)];
+    int first = Find(uf, a);
+    int second = Find(uf, b);
     // Do nothing if they are in the same group
     if (first == second) {
         return;
     }
     // Merge the smaller group into the larger group
-    if (uf.groupSize[first->val] >= uf.groupSize[second->val]) {
-        second->next = first;
-        uf.groupSize[first->val] += uf.groupSize[second->val];
-        uf.groupSize[second->val] = 0;
-    } else {
-        first->next = second;
-        uf.groupSize[second->val] += uf.groupSize[first->val];
-        uf.groupSize[first->val] = 0;
+    if (uf.groupSize[first] < uf.groupSize[second]) {
+        swap(first, second);
     }
+    uf.parent[second] = first;
+    uf.groupSize[first] += uf.groupSize[second];
+    uf.groupSize[second] = 0;
 }
 
 // ----------------------------------------------------------------------------------------------------------
 
 
+// CONCURRENT UNION FIND ------------------------------------------------------------------------------------
+
+// A lock-free union-find that any number of threads may call Find, Union and SameSet on at the same time
+// Refer to concurrent_union_find.h for implementation. It is shared with the parallel connected components and
+//  Boruvka algorithms of undirected_graph.cpp.
+
+// ----------------------------------------------------------------------------------------------------------
+
+
 // KRUSKAL'S MINIMUM SPANNING TREE ALGORITHM ----------------------------------------------------------------
 
 // Requires the above methods to be included
@@ -81,7 +87,7 @@ void Union(UnionFind &uf, int a, int b) {
 // Runs in O(mlogn) time
 
 // Sort by edge length ascending
-bool lenAsc(pair<int,pi> a, pair<int,pi> b) {
+bool lenAsc(const pair<int,pi> &a, const pair<int,pi> &b) {
     return a.first < b.first;
 }
 
@@ -103,6 +109,119 @@ vector<pi> getMST2(int n, vector<pair<int,pi>> edges) {
 // ----------------------------------------------------------------------------------------------------------
 
 
+// FILTER-KRUSKAL MINIMUM SPANNING TREE ALGORITHM -----------------------------------------------------------
+
+// Kruskal's algorithm without sorting the edges that cannot matter (Osipov, Sanders and Singler)
+// Edges are split around a pivot length. The light part is solved first, recursively. By then many heavy edges
+//  join nodes that are already connected, so they are filtered out before the heavy part is split in turn.
+//  Small parts are sorted and scanned as in Kruskal's. The search stops as soon as the tree has n-1 edges.
+// Partitioning and filtering run on numThreads threads, halved at each level of the recursion so that parts
+//  below depth log2(numThreads) are handled serially. Small parts are sorted serially, with an LSD radix sort
+//  on the lengths if radix is set and a comparison sort otherwise.
+// Returns the same kind of edge list as getMST2, in O(m + nlogn log(m/n)) expected time on random lengths
+
+// Sorts edges[begin, end) by length ascending with a stable LSD radix sort over 11-bit digits
+// Negative lengths are handled by flipping the sign bit. Passes whose digit is the same for every edge are
+//  skipped. Runs in O(m) time.
+void radixSortByLength(vector<pair<int,pi>> &edges, long long begin, long long end) {
+    const int bits = 11, buckets = 1 << bits;
+    long long len = end - begin;
+    vector<pair<int,pi>> tmp(len);
+    vector<long long> count(buckets + 1);
+    pair<int,pi>* from = &edges[begin];
+    pair<int,pi>* to = tmp.data();
+    auto key = [](const pair<int,pi> &e) { return (uint32_t)e.first ^ 0x80000000u; };
+    for (int shift=0; shift<32; shift+=bits) {
+        fill(count.begin(), count.end(), 0);
+        for (long long i=0; i<len; i++) {
+            count[((key(from[i]) >> shift) & (buckets - 1)) + 1]++;
+        }
+        if (*max_element(count.begin(), count.end()) == len) {
+            continue;
+        }
+        for (int d=0; d<buckets; d++) {
+            count[d+1] += count[d];
+        }
+        for (long long i=0; i<len; i++) {
+            to[count[(key(from[i]) >> shift) & (buckets - 1)]++] = from[i];
+        }
+        swap(from, to);
+    }
+    if (from != &edges[begin]) {
+        copy(from, from + len, &edges[begin]);
+    }
+}
+
+// Solves edges[lo, hi), adding its tree edges to MST
+void filterKruskal(vector<pair<int,pi>> &edges, long long lo, long long hi, UnionFind &uf, vector<pi> &MST,
+                   bool radix, int numThreads) {
+    const long long baseSize = 1 << 14;
+    int n = (int)uf.parent.size();
+    if (hi - lo <= 0 || (long long)MST.size() + 1 >= n) {
+        return;
+    }
+    long long mid = hi;
+    if (hi - lo > baseSize) {
+        // Median of evenly spaced samples as the pivot
+        vector<int> sample;
+        for (int i=0; i<9; i++) {
+            sample.push_back(edges[lo + (hi - lo - 1) * i / 8].first);
+        }
+        nth_element(sample.begin(), sample.begin() + 4, sample.end());
+        int pivot = sample[4];
+        mid = parallelPartition(edges, lo, hi, [&](const pair<int,pi> &e) { return e.first <= pivot; },
+                                numThreads);
+        if (mid == hi) {
+            // pivot is the largest length. Split off the edges of exactly that length instead.
+            mid = parallelPartition(edges, lo, hi, [&](const pair<int,pi> &e) { return e.first < pivot; },
+                                    numThreads);
+        }
+    }
+    if (mid == hi || mid == lo) {
+        // Small enough, or every length is equal so that any order is sorted
+        if (mid == hi) {
+            if (radix) {
+                radixSortByLength(edges, lo, hi);
+            } else {
+                sort(edges.begin() + lo, edges.begin() + hi, lenAsc);
+            }
+        }
+        for (long long i=lo; i<hi && (long long)MST.size() + 1 < n; i++) {
+            if (Find(uf, edges[i].second.first) != Find(uf, edges[i].second.second)) {
+                Union(uf, edges[i].second.first, edges[i].second.second);
+                MST.push_back(edges[i].second);
+            }
+        }
+        return;
+    }
+    
+    int childThreads = max(1, numThreads / 2);
+    filterKruskal(edges, lo, mid, uf, MST, radix, childThreads);
+    // Keep the heavy edges that still cross components. Roots are found without path halving, since the
+    //  union-find is read concurrently.
+    auto root = [&](int a) {
+        while (uf.parent[a] != (uint32_t)a) {
+            a = uf.parent[a];
+        }
+        return a;
+    };
+    long long end = parallelPartition(edges, mid, hi, [&](const pair<int,pi> &e) {
+        return root(e.second.first) != root(e.second.second);
+    }, numThreads);
+    filterKruskal(edges, mid, end, uf, MST, radix, childThreads);
+}
+
+// Each pair in edges is structured as (length, endpoints)
+vector<pi> getMSTFilter(int n, vector<pair<int,pi>> edges, bool radix = false, int numThreads = defaultThreads()) {
+    vector<pi> MST;
+    UnionFind uf = makeUF(n);
+    filterKruskal(edges, 0, edges.size(), uf, MST, radix, numThreads);
+    return MST;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+
 // MAXIMUM SPACING K-CLUSTERING -----------------------------------------------------------------------------
 
 // Given n nodes and pairwise distances, returns a k-clustering with maximum spacing. That is, we seek to
@@ -146,6 +265,154 @@ vector<vector<int>> maxSpaceCluster(vector<pair<int,pi>> edges, int n, int k) {
 // ----------------------------------------------------------------------------------------------------------
 
 
+// SINGLE-LINKAGE DENDROGRAM --------------------------------------------------------------------------------
+
+// Records every merge of Kruskal's algorithm once, so that the clustering for any k or any distance threshold
+//  can be read off afterwards in O(n) time instead of rerunning maxSpaceCluster
+// Clusters are numbered as in SciPy: the nodes are clusters 0 to n-1, and the i-th merge creates cluster n+i.
+//  Merges are stored in Kruskal order, so their lengths never decrease and the first j merges give the
+//  clustering after j unions.
+
+struct Dendrogram {
+    int n;
+    vector<pi> merges; // The two clusters joined by each merge
+    vector<int> heights; // Length of the edge behind each merge
+};
+
+// Each pair in edges is structured as (length, endpoints)
+// Has n-1 merges if the graph is connected, and one fewer for each extra connected component
+// Runs in O(mlogm) time
+Dendrogram buildDendrogram(int n, vector<pair<int,pi>> edges) {
+    Dendrogram d {n, {}, {}};
+    sort(edges.begin(), edges.end(), lenAsc);
+    UnionFind uf = makeUF(n);
+    vector<int> cluster(n); // Current cluster id of each union-find root
+    for (int i=0; i<n; i++) {
+        cluster[i] = i;
+    }
+    for (pair<int,pi> edge : edges) {
+        int a = Find(uf, edge.second.first);
+        int b = Find(uf, edge.second.second);
+        if (a != b) {
+            d.merges.push_back(make_pair(cluster[a], cluster[b]));
+            d.heights.push_back(edge.first);
+            Union(uf, a, b);
+            cluster[Find(uf, a)] = n + (int)d.merges.size() - 1;
+        }
+    }
+    return d;
+}
+
+// Returns the clusters after the first j merges, in the same form as maxSpaceCluster
+// Every merge has a larger id than the clusters it joins, so one pass over the ids from high to low labels each
+//  cluster with its ancestor that is still unmerged
+vector<vector<int>> cutDendrogram(const Dendrogram &d, int j) {
+    int n = d.n;
+    j = max(0, min(j, (int)d.merges.size()));
+    vector<int> mergedBy(n + j, j); // Merge that consumed each cluster, or j if none of the first j did
+    for (int i=0; i<j; i++) {
+        mergedBy[d.merges[i].first] = i;
+        mergedBy[d.merges[i].second] = i;
+    }
+    vector<int> label(n + j);
+    for (int c = n + j - 1; c >= 0; c--) {
+        label[c] = mergedBy[c] == j ? c : label[n + mergedBy[c]];
+    }
+    // Number the clusters in order of their smallest node, as maxSpaceCluster does
+    vector<vector<int>> clusters;
+    vector<int> index(n + j, -1);
+    for (int i=0; i<n; i++) {
+        int top = label[i];
+        if (index[top] == -1) {
+            index[top] = (int)clusters.size();
+            clusters.push_back({});
+        }
+        clusters[index[top]].push_back(i);
+    }
+    return clusters;
+}
+
+// The k-clustering with maximum spacing, or the clustering of each connected component if there are more than k
+vector<vector<int>> clustersForK(const Dendrogram &d, int k) {
+    return cutDendrogram(d, d.n - k);
+}
+
+// The clusters formed by linking every pair of nodes at distance at most threshold
+vector<vector<int>> clustersWithin(const Dendrogram &d, int threshold) {
+    return cutDendrogram(d, (int)(upper_bound(d.heights.begin(), d.heights.end(), threshold) - d.heights.begin()));
+}
+
+// File layout, in native byte order: a DendrogramHeader, then the merges as int pairs and the heights as ints
+const char DENDROGRAM_MAGIC[8] = {'D','E','N','D','R','O','G','M'};
+const uint32_t DENDROGRAM_VERSION = 1;
+
+struct DendrogramHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t n;
+    int32_t numMerges;
+};
+
+// Both return false on I/O errors, and loading also on files that do not hold a valid dendrogram
+bool saveDendrogram(const Dendrogram &d, const string &path) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+    DendrogramHeader h {};
+    memcpy(h.magic, DENDROGRAM_MAGIC, sizeof(h.magic));
+    h.version = DENDROGRAM_VERSION;
+    h.n = d.n;
+    h.numMerges = (int32_t)d.merges.size();
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+              fwrite(d.merges.data(), sizeof(pi), d.merges.size(), f) == d.merges.size() &&
+              fwrite(d.heights.data(), sizeof(int), d.heights.size(), f) == d.heights.size();
+    return fclose(f) == 0 && ok;
+}
+
+// Checks what buildDendrogram guarantees: merge i joins two distinct clusters with ids below n+i that no earlier
+//  merge consumed, and the heights never decrease. cutDendrogram relies on both.
+bool validDendrogram(const Dendrogram &d) {
+    vector<char> used(d.n + d.merges.size());
+    for (size_t i=0; i<d.merges.size(); i++) {
+        long long limit = d.n + (long long)i;
+        int a = d.merges[i].first, b = d.merges[i].second;
+        if (a < 0 || b < 0 || a >= limit || b >= limit || a == b || used[a] || used[b]) {
+            return false;
+        }
+        used[a] = used[b] = 1;
+        if (i > 0 && d.heights[i] < d.heights[i-1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool loadDendrogram(const string &path, Dendrogram &d) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+    DendrogramHeader h {};
+    bool ok = fread(&h, sizeof(h), 1, f) == 1 && memcmp(h.magic, DENDROGRAM_MAGIC, sizeof(h.magic)) == 0 &&
+              h.version == DENDROGRAM_VERSION && h.n >= 0 && h.numMerges >= 0 && h.numMerges < max(h.n, 1);
+    // The file size has to match the header before anything is sized from it
+    long long expected = (long long)sizeof(h) + (long long)h.numMerges * (sizeof(pi) + sizeof(int));
+    ok = ok && fseek(f, 0, SEEK_END) == 0 && ftell(f) == expected && fseek(f, sizeof(h), SEEK_SET) == 0;
+    if (ok) {
+        d.n = h.n;
+        d.merges.resize(h.numMerges);
+        d.heights.resize(h.numMerges);
+        ok = fread(d.merges.data(), sizeof(pi), d.merges.size(), f) == d.merges.size() &&
+             fread(d.heights.data(), sizeof(int), d.heights.size(), f) == d.heights.size() && validDendrogram(d);
+    }
+    fclose(f);
+    return ok;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+
 // TARJAN'S OFF-LINE LOWEST COMMON ANCESTOR ALGORITHM FOR TREES ---------------------------------------------
 
 // Provided a tree of N nodes and a series of Q node pairs, find the LCA of each given pair of nodes.
@@ -154,7 +421,7 @@ vector<vector<int>> maxSpaceCluster(vector<pair<int,pi>> edges, int n, int k) {
 // Prints the LCA of each pair in queries
 // The tree is represented by adjacency lists of directed, hierarchal edges. Each node has an edge to its
 //  children but not to its parent
-void getLCA(tree t, int root, vector<pi> queries) {
+void getLCA(const tree &t, int root, const vector<pi> &queries) {
     // Two copies of each query is saved.
     vector<vector<int>> req(t.size());
     for (pi q : queries) {
@@ -185,7 +452,7 @@ void getLCA(tree t, int root, vector<pi> queries) {
             for (int target : req[cur]) {
                 // Answer each query the second time it is encountered
                 if (explored[target] == 2) {
-                    cout << "LCM of " << cur << " and " << target << " is " << anc[Find(uf, target)] << endl;
+                    cout << "LCA of " << cur << " and " << target << " is " << anc[Find(uf, target)] << endl;
                 }
             }
             Union(uf, par[cur], cur); // Merging up
@@ -198,3 +465,226 @@ void getLCA(tree t, int root, vector<pi> queries) {
 
 // ----------------------------------------------------------------------------------------------------------
 
+
+// ONLINE LOWEST COMMON ANCESTOR: DFS ORDER AND SPARSE TABLE ------------------------------------------------
+
+// Answers LCA queries one at a time, in any order, in O(1) each after O(nlogn) preprocessing
+// Lay the nodes out in DFS preorder. For two different nodes u and v with u first, every node between them
+//  (excluding u, including v) lies below lca(u, v), and the child of the LCA on the way to v is among them. So
+//  the LCA is the parent with the smallest position among those nodes, which is a range minimum over the
+//  positions of their parents. A sparse table answers range minimums with two overlapping power-of-two blocks.
+// This takes n entries per table level, half of what an Euler tour of 2n-1 entries would.
+
+// The tree is represented as in getLCA, and must contain all n nodes
+struct LCAIndex {
+    vector<int> order; // Nodes in preorder
+    vector<int> pos; // pos[i] = position of node i in order
+    int levels;
+    vector<int> table; // Row k starts at k*n: table[k*n + i] = minimum parent position over order[i..i+2^k-1]
+};
+
+LCAIndex buildLCAIndex(const tree &t, int root) {
+    int n = (int)t.size();
+    LCAIndex idx {{}, vector<int>(n), 1, {}};
+    idx.order.reserve(n);
+    vector<int> parentPos(n); // Indexed by position
+    stack<int> s;
+    s.push(root);
+    while (!s.empty()) {
+        int cur = s.top();
+        s.pop();
+        idx.pos[cur] = (int)idx.order.size();
+        idx.order.push_back(cur);
+        for (int child : t[cur]) {
+            s.push(child);
+        }
+    }
+    for (int i=0; i<n; i++) {
+        for (int child : t[i]) {
+            parentPos[idx.pos[child]] = idx.pos[i];
+        }
+    }
+    
+    while ((1 << idx.levels) <= n) {
+        idx.levels++;
+    }
+    idx.table.resize((size_t)idx.levels * n);
+    copy(parentPos.begin(), parentPos.end(), idx.table.begin());
+    for (int k=1; k<idx.levels; k++) {
+        const int* prev = &idx.table[(size_t)(k-1) * n];
+        int* row = &idx.table[(size_t)k * n];
+        int half = 1 << (k-1);
+        for (int i=0; i + 2*half <= n; i++) {
+            row[i] = min(prev[i], prev[i + half]);
+        }
+    }
+    return idx;
+}
+
+// Returns the LCA of a and b in O(1) time
+int queryLCA(const LCAIndex &idx, int a, int b) {
+    if (a == b) {
+        return a;
+    }
+    int lo = min(idx.pos[a], idx.pos[b]) + 1;
+    int hi = max(idx.pos[a], idx.pos[b]);
+    int k = 31 - __builtin_clz(hi - lo + 1); // Largest power of two that fits in the range
+    int n = (int)idx.order.size();
+    int best = min(idx.table[(size_t)k * n + lo], idx.table[(size_t)k * n + hi - (1 << k) + 1]);
+    return idx.order[best];
+}
+
+// Answers every pair in queries on numThreads threads. The i-th result is the LCA of queries[i].
+vector<int> queryLCABatch(const LCAIndex &idx, const vector<pi> &queries, int numThreads = defaultThreads()) {
+    vector<int> res(queries.size());
+    parallelFor(0, queries.size(), [&](long long i) {
+        res[i] = queryLCA(idx, queries[i].first, queries[i].second);
+    }, numThreads, 4096);
+    return res;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+
+// ROLLBACK UNION FIND AND OFFLINE DYNAMIC CONNECTIVITY -----------------------------------------------------
+
+// A union-find whose unions can be undone in reverse order
+// Path compression would rewrite pointers that later undos cannot track, so Find only walks up, and union by
+//  rank keeps every path O(logn) long. Each successful union records what it changed on a history stack.
+
+struct RollbackUF {
+    vector<int> parent;
+    vector<int> rank;
+    vector<pi> history; // (root that was linked, 1 if the rank of its new parent grew)
+};
+
+RollbackUF makeRollbackUF(int n) {
+    RollbackUF uf {vector<int>(n), vector<int>(n), {}};
+    for (int i=0; i<n; i++) {
+        uf.parent[i] = i;
+    }
+    return uf;
+}
+
+// O(logn) worst case
+int Find(RollbackUF &uf, int a) {
+    while (uf.parent[a] != a) {
+        a = uf.parent[a];
+    }
+    return a;
+}
+
+// Returns true if a and b were in different groups, which are merged
+// O(logn) worst case
+bool Union(RollbackUF &uf, int a, int b) {
+    a = Find(uf, a);
+    b = Find(uf, b);
+    if (a == b) {
+        return false;
+    }
+    if (uf.rank[a] < uf.rank[b]) {
+        swap(a, b);
+    }
+    uf.parent[b] = a;
+    bool grew = uf.rank[a] == uf.rank[b];
+    uf.rank[a] += grew;
+    uf.history.push_back(make_pair(b, grew ? 1 : 0));
+    return true;
+}
+
+// Undoes every union made since history had the given size, most recent first
+void Rollback(RollbackUF &uf, size_t checkpoint) {
+    while (uf.history.size() > checkpoint) {
+        pi h = uf.history.back();
+        uf.history.pop_back();
+        uf.rank[uf.parent[h.first]] -= h.second;
+        uf.parent[h.first] = h.first;
+    }
+}
+
+// Answers connectivity queries on a log of edge insertions and deletions, given in full ahead of time
+// Each edge is alive during an interval of the log. The intervals are added to a segment tree over time, which
+//  stores each one in O(logT) nodes. A depth-first walk of the tree unions the edges of each node on the way
+//  down and rolls them back on the way up, so at every leaf the union-find holds exactly the edges alive at
+//  that moment.
+// Runs in O(T logT logn) time for a log of T events
+
+enum ConnectivityOp { ADD_EDGE, REMOVE_EDGE, QUERY };
+
+struct ConnectivityEvent {
+    ConnectivityOp op;
+    int u, v;
+};
+
+// Adds edges alive during [lo, hi) to the segment tree node covering [nodeLo, nodeHi)
+void addInterval(vector<vector<pi>> &seg, int node, int nodeLo, int nodeHi, int lo, int hi, pi edge) {
+    if (hi <= nodeLo || nodeHi <= lo) {
+        return;
+    }
+    if (lo <= nodeLo && nodeHi <= hi) {
+        seg[node].push_back(edge);
+        return;
+    }
+    int mid = (nodeLo + nodeHi) / 2;
+    addInterval(seg, 2*node, nodeLo, mid, lo, hi, edge);
+    addInterval(seg, 2*node+1, mid, nodeHi, lo, hi, edge);
+}
+
+void answerConnectivity(const vector<vector<pi>> &seg, int node, int nodeLo, int nodeHi,
+                        const vector<ConnectivityEvent> &events, RollbackUF &uf, vector<bool> &answers,
+                        const vector<int> &queryIndex) {
+    size_t checkpoint = uf.history.size();
+    for (pi e : seg[node]) {
+        Union(uf, e.first, e.second);
+    }
+    if (nodeHi - nodeLo == 1) {
+        if (events[nodeLo].op == QUERY) {
+            answers[queryIndex[nodeLo]] = Find(uf, events[nodeLo].u) == Find(uf, events[nodeLo].v);
+        }
+    } else {
+        int mid = (nodeLo + nodeHi) / 2;
+        answerConnectivity(seg, 2*node, nodeLo, mid, events, uf, answers, queryIndex);
+        answerConnectivity(seg, 2*node+1, mid, nodeHi, events, uf, answers, queryIndex);
+    }
+    Rollback(uf, checkpoint);
+}
+
+// Given n nodes and a log of events, returns whether u and v are connected for each QUERY event, in order
+// Parallel edges are counted, so an edge stays alive until it has been removed as often as it was added.
+//  Removing an edge that is not present is ignored.
+vector<bool> offlineConnectivity(int n, const vector<ConnectivityEvent> &events) {
+    int T = (int)events.size();
+    vector<bool> answers;
+    if (T == 0) {
+        return answers;
+    }
+    vector<vector<pi>> seg(4 * T);
+    map<pi, vector<int>> open; // Start times of the live copies of each edge
+    vector<int> queryIndex(T, -1);
+    for (int t=0; t<T; t++) {
+        pi key = make_pair(min(events[t].u, events[t].v), max(events[t].u, events[t].v));
+        if (events[t].op == ADD_EDGE) {
+            open[key].push_back(t);
+        } else if (events[t].op == REMOVE_EDGE) {
+            auto it = open.find(key);
+            if (it != open.end() && !it->second.empty()) {
+                addInterval(seg, 1, 0, T, it->second.back(), t, key);
+                it->second.pop_back();
+            }
+        } else {
+            queryIndex[t] = (int)answers.size();
+            answers.push_back(false);
+        }
+    }
+    for (auto &p : open) {
+        for (int start : p.second) {
+            addInterval(seg, 1, 0, T, start, T, p.first);
+        }
+    }
+    
+    RollbackUF uf = makeRollbackUF(n);
+    answerConnectivity(seg, 1, 0, T, events, uf, answers, queryIndex);
+    return answers;
+}
+
+// ----------------------------------------------------------------------------------------------------------